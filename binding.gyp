@@ -14,7 +14,15 @@
                      "lib/linux/memory.cc",
                      "lib/linux/process.cc",
                      "lib/linux/module.cc",
-                     "lib/linux/pattern.cc"
+                     "lib/linux/pattern.cc",
+                     "lib/linux/watcher.cc",
+                     "lib/linux/scanner.cc",
+                     "lib/linux/signaturecache.cc",
+                     "lib/linux/valuescanner.cc",
+                     "lib/linux/scansession.cc",
+                     "lib/linux/blockcompressor.cc",
+                     "lib/linux/spillbuffer.cc",
+                     "lib/linux/pointerscanner.cc"
                   ]
                }
             ],
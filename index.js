@@ -1,4 +1,36 @@
 const memoryjs = require('./build/Release/memoryjs');
+const Watcher = require('./watcher');
+
+function abortError(signal) {
+  if (signal.reason !== undefined) {
+    return signal.reason;
+  }
+
+  const error = new Error('The operation was aborted');
+  error.name = 'AbortError';
+  return error;
+}
+
+// Runs a promise-based native function, wiring an optional AbortSignal to a native cancel token.
+function runCancellable(signal, start) {
+  if (!signal) {
+    return start(undefined);
+  }
+
+  if (signal.aborted) {
+    return Promise.reject(abortError(signal));
+  }
+
+  const token = memoryjs.createCancelToken();
+  const onAbort = () => memoryjs.cancel(token);
+  signal.addEventListener('abort', onAbort, { once: true });
+
+  return start(token)
+    .catch((error) => {
+      throw signal.aborted ? abortError(signal) : error;
+    })
+    .finally(() => signal.removeEventListener('abort', onAbort));
+}
 
 module.exports = {
   // data type constants
@@ -29,6 +61,24 @@ module.exports = {
   READ: 0x1,
   SUBTRACT: 0x2,
 
+  // region permission bits (Linux)
+  REGION_READ: 0x1,
+  REGION_WRITE: 0x2,
+  REGION_EXECUTE: 0x4,
+  REGION_SHARED: 0x8,
+
+  // scan predicate constants (Linux)
+  SCAN_CHANGED: 'changed',
+  SCAN_UNCHANGED: 'unchanged',
+  SCAN_INCREASED: 'increased',
+  SCAN_DECREASED: 'decreased',
+  SCAN_EQUAL: 'equal',
+  SCAN_RANGE: 'range',
+
+  // read backend constants
+  BACKEND_VM_READV: 0x0,
+  BACKEND_PROC_MEM: 0x1,
+
   // function data type constants
   T_VOID: 0x0,
   T_STRING: 0x1,
@@ -90,6 +140,54 @@ module.exports = {
     memoryjs.findModule(moduleName, processId, callback);
   },
 
+  getModules(processId, callback) {
+    if (arguments.length === 1) {
+      return memoryjs.getModules(processId);
+    }
+
+    memoryjs.getModules(processId, callback);
+  },
+
+  getRegions(handle, callback) {
+    if (arguments.length === 1) {
+      return memoryjs.getRegions(handle);
+    }
+
+    memoryjs.getRegions(handle, callback);
+  },
+
+  getRegionTable(handle) {
+    return memoryjs.getRegionTable(handle);
+  },
+
+  findRegionForAddress(handle, addresses) {
+    return memoryjs.findRegionForAddress(handle, addresses);
+  },
+
+  setReadBackend(handle, backend) {
+    if (arguments.length === 1) {
+      return memoryjs.setReadBackend(handle);
+    }
+
+    return memoryjs.setReadBackend(handle, backend);
+  },
+
+  getReadBackend(handle) {
+    return memoryjs.getReadBackend(handle);
+  },
+
+  setScanOptions(options) {
+    return memoryjs.setScanOptions(options);
+  },
+
+  getScanOptions() {
+    return memoryjs.getScanOptions();
+  },
+
+  setSignatureCache(path) {
+    return memoryjs.setSignatureCache(path);
+  },
+
   readMemory(handle, address, dataType, callback) {
     if (arguments.length === 3) {
       return memoryjs.readMemory(handle, address, dataType.toLowerCase());
@@ -98,6 +196,74 @@ module.exports = {
     memoryjs.readMemory(handle, address, dataType.toLowerCase(), callback);
   },
 
+  readString(handle, address, maxLength, callback) {
+    if (arguments.length === 3) {
+      return memoryjs.readString(handle, address, maxLength);
+    }
+
+    memoryjs.readString(handle, address, maxLength, callback);
+  },
+
+  readMemoryBatch(handle, entries, callback) {
+    const requests = entries.map(({ address, type }) => ({ address, type: type.toLowerCase() }));
+
+    if (arguments.length === 2) {
+      return memoryjs.readMemoryBatch(handle, requests);
+    }
+
+    memoryjs.readMemoryBatch(handle, requests, callback);
+  },
+
+  readPointerChain(handle, base, offsets, dataType, pointerSize) {
+    return memoryjs.readPointerChain(handle, base, offsets, dataType.toLowerCase(), pointerSize);
+  },
+
+  readPointerChains(handle, chains, pointerSize) {
+    const requests = chains.map(({ base, offsets, type }) => ({ base, offsets, type: type.toLowerCase() }));
+    return memoryjs.readPointerChains(handle, requests, pointerSize);
+  },
+
+  createPointerMap(handle, pointerSize) {
+    return memoryjs.createPointerMap(handle, pointerSize);
+  },
+
+  findPointerPaths(map, address, options) {
+    return memoryjs.findPointerPaths(map, address, options || {});
+  },
+
+  // Paths of `paths` that were also found in `others`, e.g. after restarting the target
+  intersectPointerPaths(paths, others) {
+    const key = ({ module, offsets }) => `${module}:${offsets.join(',')}`;
+    const found = new Set(others.map(key));
+    return paths.filter(path => found.has(key(path)));
+  },
+
+  savePointerMap: memoryjs.savePointerMap,
+  loadPointerMap: memoryjs.loadPointerMap,
+  closePointerMap: memoryjs.closePointerMap,
+
+  defineStruct(fields) {
+    const layout = {};
+    Object.keys(fields).forEach((name) => {
+      const [dataType, offset] = fields[name];
+      layout[name] = [dataType.toLowerCase(), offset];
+    });
+
+    return memoryjs.defineStruct(layout);
+  },
+
+  readStruct(handle, address, layout) {
+    return memoryjs.readStruct(handle, address, layout);
+  },
+
+  readStructArray(handle, address, layout, count, stride) {
+    if (stride === undefined) {
+      return memoryjs.readStructArray(handle, address, layout, count);
+    }
+
+    return memoryjs.readStructArray(handle, address, layout, count, stride);
+  },
+
   readBuffer(handle, address, size, callback) {
     if (arguments.length === 3) {
       return memoryjs.readBuffer(handle, address, size);
@@ -106,6 +272,27 @@ module.exports = {
     memoryjs.readBuffer(handle, address, size, callback);
   },
 
+  readBufferInto(handle, address, target, offset = 0, length) {
+    // N-API cannot see into a bare SharedArrayBuffer, only into views over it
+    if (typeof SharedArrayBuffer !== 'undefined' && target instanceof SharedArrayBuffer) {
+      target = new Uint8Array(target);
+    }
+
+    if (length === undefined) {
+      return memoryjs.readBufferInto(handle, address, target, offset);
+    }
+
+    return memoryjs.readBufferInto(handle, address, target, offset, length);
+  },
+
+  readBufferPartial(handle, address, size, callback) {
+    if (arguments.length === 3) {
+      return memoryjs.readBufferPartial(handle, address, size);
+    }
+
+    memoryjs.readBufferPartial(handle, address, size, callback);
+  },
+
   getProcessPath(handle) {
       return memoryjs.getProcessPath(handle);
   },
@@ -138,5 +325,100 @@ module.exports = {
     memoryjs.findPattern(handle, moduleName, signature, signatureType, patternOffset, addressOffset, callback);
   },
 
-  closeProcess: memoryjs.closeProcess, // nop
+  getProcessesAsync({ signal } = {}) {
+    return runCancellable(signal, token => memoryjs.getProcessesAsync(token));
+  },
+
+  findModuleAsync(moduleName, processId, { signal } = {}) {
+    return runCancellable(signal, token => memoryjs.findModuleAsync(moduleName, processId, token));
+  },
+
+  readMemoryAsync(handle, address, dataType, { signal } = {}) {
+    return runCancellable(signal, token => memoryjs.readMemoryAsync(handle, address, dataType.toLowerCase(), token));
+  },
+
+  readBufferAsync(handle, address, size, { signal } = {}) {
+    return runCancellable(signal, token => memoryjs.readBufferAsync(handle, address, size, token));
+  },
+
+  findPatternAsync(handle, moduleName, signature, signatureType, patternOffset, addressOffset, skip = 0, { signal } = {}) {
+    return runCancellable(signal, token => memoryjs.findPatternAsync(handle, moduleName, signature, signatureType, patternOffset, addressOffset, skip, token));
+  },
+
+  createWatcher(handle) {
+    return new Watcher(memoryjs, handle);
+  },
+
+  findPatterns(handle, moduleName, signatures, callback) {
+    if (arguments.length === 3) {
+      return memoryjs.findPatterns(handle, moduleName, signatures);
+    }
+
+    memoryjs.findPatterns(handle, moduleName, signatures, callback);
+  },
+
+  findPatternAll(handle, moduleName, signature, options, callback) {
+    if (typeof options === 'function') {
+      return memoryjs.findPatternAll(handle, moduleName, signature, {}, options);
+    }
+
+    if (callback) {
+      return memoryjs.findPatternAll(handle, moduleName, signature, options || {}, callback);
+    }
+
+    return memoryjs.findPatternAll(handle, moduleName, signature, options || {});
+  },
+
+  scanValue(handle, dataType, value, options, callback) {
+    if (typeof options === 'function') {
+      return memoryjs.scanValue(handle, dataType, value, {}, options);
+    }
+
+    if (callback) {
+      return memoryjs.scanValue(handle, dataType, value, options || {}, callback);
+    }
+
+    return memoryjs.scanValue(handle, dataType, value, options || {});
+  },
+
+  createScanSession(handle, dataType, value, options) {
+    return memoryjs.createScanSession(handle, dataType, value, options || {});
+  },
+
+  nextScan(session, predicate, ...values) {
+    return memoryjs.nextScan(session, predicate, ...values);
+  },
+
+  createScanSessionAsync(handle, dataType, value, options) {
+    const { signal } = options || {};
+    return runCancellable(signal, token => memoryjs.createScanSessionAsync(handle, dataType, value, options || {}, token));
+  },
+
+  // the values may be followed by { signal }
+  nextScanAsync(session, predicate, ...values) {
+    const last = values[values.length - 1];
+    const { signal } = last !== null && typeof last === 'object' ? values.pop() : {};
+    return runCancellable(signal, token => memoryjs.nextScanAsync(session, predicate, ...values, token));
+  },
+
+  getScanResults(session, first = 0, limit = undefined) {
+    return memoryjs.getScanResults(session, first, limit);
+  },
+
+  closeScanSession: memoryjs.closeScanSession,
+
+  createPointerMapAsync(handle, pointerSize, { signal } = {}) {
+    return runCancellable(signal, token => memoryjs.createPointerMapAsync(handle, pointerSize, token));
+  },
+
+  findPointerPathsAsync(map, address, options) {
+    const { signal } = options || {};
+    return runCancellable(signal, token => memoryjs.findPointerPathsAsync(map, address, options || {}, token));
+  },
+
+  findPatternsAsync(handle, moduleName, signatures, { signal } = {}) {
+    return runCancellable(signal, token => memoryjs.findPatternsAsync(handle, moduleName, signatures, token));
+  },
+
+  closeProcess: memoryjs.closeProcess, // releases per-handle read state
 };
@@ -0,0 +1,181 @@
+#include <cstring>
+#include "blockcompressor.h"
+
+// Every sequence is a token byte, literals and a match:
+//   token     high nibble: literal count, low nibble: match length - 4 (15 = more bytes follow)
+//   literals  a byte of 255 per extra 255 literals and a final byte < 255, then the literals
+//   match     16-bit little endian distance back, then the extra length bytes like literals
+// The last sequence has literals only and ends the block.
+
+namespace {
+  const size_t minimumMatch = 4;
+  const size_t maximumDistance = 0xFFFF;
+  const unsigned hashBits = 12;
+
+  inline uint32_t read32(const unsigned char* data) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+  }
+
+  inline uint64_t read64(const unsigned char* data) {
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+  }
+
+  inline uint32_t hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - hashBits);
+  }
+
+  // Length of the match at `position` against the earlier `candidate`, which share their first 4 bytes
+  inline size_t matchLength(const unsigned char* data, size_t candidate, size_t position, size_t size) {
+    size_t length = minimumMatch;
+
+    while (position + length + 8 <= size) {
+      uint64_t difference = read64(data + position + length) ^ read64(data + candidate + length);
+      if (difference != 0) return length + __builtin_ctzll(difference) / 8;
+      length += 8;
+    }
+
+    while (position + length < size && data[position + length] == data[candidate + length]) length++;
+    return length;
+  }
+
+  inline unsigned char* writeLength(unsigned char* out, size_t length) {
+    for (; length >= 255; length -= 255) *out++ = 255;
+    *out++ = (unsigned char)length;
+    return out;
+  }
+
+  inline unsigned char* writeSequence(unsigned char* out, const unsigned char* literals, size_t literalCount, size_t distance, size_t length) {
+    unsigned char* token = out++;
+    *token = (unsigned char)((literalCount < 15 ? literalCount : 15) << 4);
+    if (literalCount >= 15) out = writeLength(out, literalCount - 15);
+
+    memcpy(out, literals, literalCount);
+    out += literalCount;
+
+    if (length == 0) return out;
+
+    out[0] = (unsigned char)distance;
+    out[1] = (unsigned char)(distance >> 8);
+    out += 2;
+
+    size_t extra = length - minimumMatch;
+    *token |= (unsigned char)(extra < 15 ? extra : 15);
+    if (extra >= 15) out = writeLength(out, extra - 15);
+    return out;
+  }
+
+  inline bool readLength(const unsigned char*& in, const unsigned char* end, size_t* length) {
+    for (;;) {
+      if (in >= end) return false;
+      unsigned char byte = *in++;
+      *length += byte;
+      if (byte != 255) return true;
+    }
+  }
+}
+
+size_t blockCompressor::compressBound(size_t size) {
+  // Worst case: all literals plus their length bytes and a token
+  return size + size / 255 + 16;
+}
+
+size_t blockCompressor::compress(const unsigned char* data, size_t size, unsigned char* output) {
+  // Nothing to store; `data` may be NULL
+  if (size == 0) return 0;
+
+  unsigned char* op = output;
+
+  uint32_t table[1 << hashBits];
+  memset(table, 0, sizeof(table));
+
+  size_t anchor = 0;
+  size_t position = 1;
+
+  // Matches are only looked for while 8-byte reads stay in bounds
+  while (size >= 8 && position + 8 <= size) {
+    uint32_t sequence = read32(data + position);
+    uint32_t slot = hash(sequence);
+    size_t candidate = table[slot];
+    table[slot] = (uint32_t)position;
+
+    if (candidate >= position || position - candidate > maximumDistance || read32(data + candidate) != sequence) {
+      // Skip ahead faster through data that does not compress
+      position += 1 + ((position - anchor) >> 6);
+      continue;
+    }
+
+    size_t length = matchLength(data, candidate, position, size);
+    op = writeSequence(op, data + anchor, position - anchor, position - candidate, length);
+    position += length;
+    anchor = position;
+  }
+
+  op = writeSequence(op, data + anchor, size - anchor, 0, 0);
+
+  size_t length = op - output;
+  if (length >= size) {
+    memcpy(output, data, size);
+    length = size;
+  }
+
+  return length;
+}
+
+bool blockCompressor::decompress(const unsigned char* data, size_t length, unsigned char* out, size_t size) {
+  if (length == size) {
+    if (size != 0) memcpy(out, data, size);
+    return true;
+  }
+
+  const unsigned char* in = data;
+  const unsigned char* end = data + length;
+  unsigned char* op = out;
+  unsigned char* const outEnd = out + size;
+
+  while (in < end) {
+    unsigned char token = *in++;
+
+    size_t literals = token >> 4;
+    if (literals == 15 && !readLength(in, end, &literals)) return false;
+    if ((size_t)(end - in) < literals || (size_t)(outEnd - op) < literals) return false;
+
+    memcpy(op, in, literals);
+    in += literals;
+    op += literals;
+
+    if (in == end) break;
+    if (end - in < 2) return false;
+
+    size_t distance = in[0] | ((size_t)in[1] << 8);
+    in += 2;
+
+    size_t match = (token & 15);
+    if (match == 15 && !readLength(in, end, &match)) return false;
+    match += minimumMatch;
+
+    if (distance == 0 || distance > (size_t)(op - out) || (size_t)(outEnd - op) < match) return false;
+
+    const unsigned char* source = op - distance;
+    if (distance == 1) {
+      memset(op, *source, match);
+      op += match;
+    } else if (distance >= 8) {
+      // Each 8-byte step only reads bytes that have already been written
+      unsigned char* matchEnd = op + match;
+      while (matchEnd - op >= 8) {
+        memcpy(op, source, 8);
+        op += 8;
+        source += 8;
+      }
+      while (op < matchEnd) *op++ = *source++;
+    } else {
+      for (size_t i = 0; i < match; i++) *op++ = *source++;
+    }
+  }
+
+  return op == outEnd;
+}
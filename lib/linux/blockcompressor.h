@@ -0,0 +1,25 @@
+#pragma once
+#ifndef BLOCKCOMPRESSOR_H
+#define BLOCKCOMPRESSOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+// A small LZ77 compressor for blocks of process memory (up to 64KB each), tuned for speed
+// over ratio: one hash probe per position, matches within the last 64KB.
+class blockCompressor {
+public:
+  // Bytes compress may write for `size` bytes of input
+  static size_t compressBound(size_t size);
+
+  // Writes the compressed form of `size` bytes to `out`, which has room for compressBound(size)
+  // bytes, and returns its length. Data that does not compress is stored as is, which is
+  // signalled by a length equal to `size`.
+  static size_t compress(const unsigned char* data, size_t size, unsigned char* out);
+
+  // Restores `size` bytes from `length` bytes written by compress. Returns false if the
+  // input is damaged.
+  static bool decompress(const unsigned char* data, size_t length, unsigned char* out, size_t size);
+};
+
+#endif
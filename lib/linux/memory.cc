@@ -1,17 +1,470 @@
 #include <node.h>
 #include <vector>
+#include <climits>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include <fcntl.h>
 #include "memory.h"
 
+namespace {
+    // Owns a /proc/<pid>/mem descriptor. Readers hold a reference for the length of a read,
+    // so closing the handle cannot close the descriptor (and free its number) under them.
+    struct memFile {
+        int fd;
+
+        explicit memFile(int fd) : fd(fd) {}
+        ~memFile() { close(fd); }
+    };
+
+    struct handleState {
+        memory::backend type = memory::B_VM_READV;
+        bool explicitBackend = false;
+        // A lazy open that failed is not retried; reads fall back to process_vm_readv
+        bool openFailed = false;
+        std::shared_ptr<memFile> memFd;
+    };
+
+    // Handles are just pids, so per-handle state lives here rather than in the handle.
+    std::mutex handlesMutex;
+    std::unordered_map<pid_t, handleState> handles;
+    memory::backend defaultBackend = memory::B_VM_READV;
+
+    // Whether any handle may read through /proc/<pid>/mem. While it is not set, reads go
+    // straight to process_vm_readv without taking handlesMutex.
+    std::atomic<bool> procMemInUse(false);
+
+    // Called with handlesMutex held after the default or a handle's backend changes
+    void updateProcMemInUse() {
+        bool inUse = defaultBackend == memory::B_PROC_MEM;
+        for (auto entry = handles.begin(); !inUse && entry != handles.end(); ++entry) {
+            inUse = entry->second.type == memory::B_PROC_MEM;
+        }
+        procMemInUse.store(inUse, std::memory_order_release);
+    }
+
+    int openMemFile(pid_t pid) {
+        char memPath[64];
+        snprintf(memPath, sizeof(memPath), "/proc/%d/mem", pid);
+        return open(memPath, O_RDONLY | O_CLOEXEC);
+    }
+
+    // Returns the /proc/<pid>/mem descriptor to read from, or an empty pointer to use
+    // process_vm_readv. The descriptor stays open for as long as the pointer is held.
+    std::shared_ptr<memFile> memFileFor(pid_t pid) {
+        if (!procMemInUse.load(std::memory_order_acquire)) {
+            return std::shared_ptr<memFile>();
+        }
+
+        std::lock_guard<std::mutex> lock(handlesMutex);
+
+        auto entry = handles.find(pid);
+        if (entry == handles.end()) {
+            if (defaultBackend == memory::B_VM_READV) {
+                return std::shared_ptr<memFile>();
+            }
+            entry = handles.insert({ pid, handleState() }).first;
+            entry->second.type = defaultBackend;
+        }
+
+        handleState& state = entry->second;
+        if (state.type != memory::B_PROC_MEM) {
+            return std::shared_ptr<memFile>();
+        }
+
+        // Opened lazily when the backend was picked through the default
+        if (!state.memFd && !state.openFailed) {
+            int fd = openMemFile(pid);
+            if (fd >= 0) {
+                state.memFd = std::make_shared<memFile>(fd);
+            } else {
+                state.openFailed = true;
+            }
+        }
+
+        return state.memFd;
+    }
+
+    // preadv reads one contiguous file range, so only runs of adjacent entries share a call.
+    size_t readBatchFromFile(int memFd, memory::batchEntry* entries, size_t count) {
+        std::vector<struct iovec> iov;
+        size_t succeeded = 0;
+        size_t index = 0;
+
+        while (index < count) {
+            iov.clear();
+
+            size_t end = index;
+            uintptr_t next = entries[index].address;
+            while (end < count && entries[end].address == next && iov.size() < (size_t) IOV_MAX) {
+                iov.push_back({ .iov_base = entries[end].buffer, .iov_len = entries[end].size });
+                next += entries[end].size;
+                end++;
+            }
+
+            ssize_t rc = preadv(memFd, iov.data(), iov.size(), (off_t)entries[index].address);
+            size_t transferred = rc < 0 ? 0 : (size_t) rc;
+
+            while (index < end && transferred >= entries[index].size) {
+                transferred -= entries[index].size;
+                entries[index].ok = true;
+                succeeded++;
+                index++;
+            }
+
+            // Skip the entry that faulted; the rest of the run gets a fresh attempt.
+            if (index < end) {
+                memset(entries[index].buffer, 0, entries[index].size);
+                entries[index].ok = false;
+                index++;
+            }
+        }
+
+        return succeeded;
+    }
+}
+
 memory::memory() {}
 memory::~memory() {}
 
-void memory::readMemoryData(pid_t pid, uintptr_t address, void *buffer, size_t size) {
+bool memory::setBackend(pid_t pid, backend type, const char** errorMessage) {
+    std::lock_guard<std::mutex> lock(handlesMutex);
+
+    handleState& state = handles[pid];
+    if (type == B_PROC_MEM && !state.memFd) {
+        int fd = openMemFile(pid);
+        if (fd < 0) {
+            *errorMessage = "cannot open /proc/.../mem";
+            handles.erase(pid);
+            updateProcMemInUse();
+            return false;
+        }
+        state.memFd = std::make_shared<memFile>(fd);
+    }
+
+    // Reads still holding the descriptor finish before it is closed
+    if (type == B_VM_READV) {
+        state.memFd.reset();
+    }
+
+    state.type = type;
+    state.explicitBackend = true;
+    state.openFailed = false;
+    updateProcMemInUse();
+    return true;
+}
+
+void memory::setDefaultBackend(backend type) {
+    std::lock_guard<std::mutex> lock(handlesMutex);
+
+    defaultBackend = type;
+
+    // Handles that only picked up the old default follow the new one
+    for (auto entry = handles.begin(); entry != handles.end();) {
+        if (!entry->second.explicitBackend) {
+            entry = handles.erase(entry);
+        } else {
+            ++entry;
+        }
+    }
+    updateProcMemInUse();
+}
+
+memory::backend memory::getBackend(pid_t pid) {
+    std::lock_guard<std::mutex> lock(handlesMutex);
+
+    auto entry = handles.find(pid);
+    return entry == handles.end() ? defaultBackend : entry->second.type;
+}
+
+void memory::closeHandle(pid_t pid) {
+    std::lock_guard<std::mutex> lock(handlesMutex);
+
+    auto entry = handles.find(pid);
+    if (entry == handles.end()) {
+        return;
+    }
+
+    // The descriptor is closed once reads still holding it have finished
+    handles.erase(entry);
+    updateProcMemInUse();
+}
+
+ssize_t memory::readRaw(pid_t pid, uintptr_t address, void *buffer, size_t size) {
+    std::shared_ptr<memFile> memFd = memFileFor(pid);
+    if (memFd) {
+        // /proc/<pid>/mem reports unmapped addresses as EIO, callers expect EFAULT
+        ssize_t rc = pread(memFd->fd, buffer, size, (off_t)address);
+        if (rc < 0 && errno == EIO) errno = EFAULT;
+        return rc;
+    }
+
     struct iovec remote_iov = {.iov_base = (void*)address, .iov_len = size };
     struct iovec local_iov = {.iov_base = buffer, .iov_len = size };
-    ssize_t rc = process_vm_readv(pid, &local_iov, 1, &remote_iov, 1, 0);
+    return process_vm_readv(pid, &local_iov, 1, &remote_iov, 1, 0);
+}
+
+void memory::readMemoryData(pid_t pid, uintptr_t address, void *buffer, size_t size) {
+    ssize_t rc = readRaw(pid, address, buffer, size);
 
     if (rc < 0 || (size_t) rc != size) {
     //    printf("error: process_vm_readv returned %zd instead of %zu (%s) address=%#lx \n", rc, size, strerror(errno), address);
         memset(buffer, 0, size);
     }
 }
+
+size_t memory::readMemoryPartial(pid_t pid, uintptr_t address, void *buffer, size_t size, std::vector<uint8_t>* validPages) {
+    const size_t page = pageSize();
+    const uintptr_t firstPage = address & ~(uintptr_t)(page - 1);
+
+    if (validPages != NULL) {
+        size_t pages = size == 0 ? 0 : (address + size - 1 - firstPage) / page + 1;
+        validPages->assign((pages + 7) / 8, 0);
+    }
+
+    size_t bytesRead = 0;
+    size_t position = 0;
+
+    while (position < size) {
+        // Read as much as possible in one go; the kernel stops at the first faulting page.
+        ssize_t rc = readRaw(pid, address + position, (char*)buffer + position, size - position);
+        size_t next = position + (rc > 0 ? (size_t) rc : 0);
+
+        // Short reads stop at the faulting page, so every page in [position, next) was read in full.
+        if (validPages != NULL && next > position) {
+            for (uintptr_t i = (address + position - firstPage) / page; i <= (address + next - 1 - firstPage) / page; i++) {
+                (*validPages)[i / 8] |= (uint8_t)(1 << (i % 8));
+            }
+        }
+
+        bytesRead += next - position;
+        position = next;
+        if (position >= size || (rc < 0 && errno != EFAULT)) {
+            break;
+        }
+
+        // Skip the page that faulted and try the remainder again.
+        size_t pageEnd = ((address + position) & ~(uintptr_t)(page - 1)) + page - address;
+        if (pageEnd > size) pageEnd = size;
+
+        memset((char*)buffer + position, 0, pageEnd - position);
+        position = pageEnd;
+    }
+
+    // The process is gone (or not accessible at all); nothing else can be read.
+    if (position < size) {
+        memset((char*)buffer + position, 0, size - position);
+    }
+
+    return bytesRead;
+}
+
+bool memory::readString(pid_t pid, uintptr_t address, size_t maxLength, std::string* result) {
+    const size_t page = pageSize();
+    char chunk[4096 * 4];
+
+    result->clear();
+
+    while (result->size() < maxLength) {
+        // Never cross a page boundary the string may not reach; a fault ends the string.
+        size_t length = page - ((address + result->size()) & (page - 1));
+        if (length > sizeof(chunk)) length = sizeof(chunk);
+        if (length > maxLength - result->size()) length = maxLength - result->size();
+
+        ssize_t rc = readRaw(pid, address + result->size(), chunk, length);
+        if (rc <= 0) {
+            return true;
+        }
+
+        const char* terminator = (const char*)memchr(chunk, '\0', rc);
+        if (terminator != NULL) {
+            result->append(chunk, terminator - chunk);
+            return true;
+        }
+
+        result->append(chunk, rc);
+        if ((size_t) rc < length) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t memory::readMemoryBatch(pid_t pid, batchEntry* entries, size_t count) {
+    std::shared_ptr<memFile> memFd = memFileFor(pid);
+    if (memFd) {
+        return readBatchFromFile(memFd->fd, entries, count);
+    }
+
+    std::vector<struct iovec> local_iov;
+    std::vector<struct iovec> remote_iov;
+    local_iov.reserve(count < (size_t) IOV_MAX ? count : (size_t) IOV_MAX);
+    remote_iov.reserve(count < (size_t) IOV_MAX ? count : (size_t) IOV_MAX);
+
+    size_t succeeded = 0;
+    size_t index = 0;
+
+    while (index < count) {
+        local_iov.clear();
+        remote_iov.clear();
+
+        for (size_t i = index; i < count && local_iov.size() < (size_t) IOV_MAX; i++) {
+            local_iov.push_back({ .iov_base = entries[i].buffer, .iov_len = entries[i].size });
+            remote_iov.push_back({ .iov_base = (void*)entries[i].address, .iov_len = entries[i].size });
+        }
+
+        ssize_t rc = process_vm_readv(pid, local_iov.data(), local_iov.size(), remote_iov.data(), remote_iov.size(), 0);
+
+        // Anything other than a fault on the first remote iovec (e.g. the process
+        // has gone away) will fail for the remaining entries too.
+        if (rc < 0 && errno != EFAULT) {
+            for (; index < count; index++) {
+                memset(entries[index].buffer, 0, entries[index].size);
+                entries[index].ok = false;
+            }
+            break;
+        }
+
+        // The kernel stops at the first remote iovec it cannot read, so every
+        // entry up to that point is complete.
+        size_t batchEnd = index + local_iov.size();
+        size_t transferred = rc < 0 ? 0 : (size_t) rc;
+        while (index < batchEnd && transferred >= entries[index].size) {
+            transferred -= entries[index].size;
+            entries[index].ok = true;
+            succeeded++;
+            index++;
+        }
+
+        // The entry the kernel stopped at is unreadable (or only partially readable);
+        // zero it like readMemoryData does and carry on with the rest.
+        if (index < batchEnd) {
+            memset(entries[index].buffer, 0, entries[index].size);
+            entries[index].ok = false;
+            index++;
+        }
+    }
+
+    return succeeded;
+}
+
+size_t memory::pageSize() {
+    static const size_t size = sysconf(_SC_PAGESIZE);
+    return size;
+}
+
+void memory::readPointerChains(pid_t pid, pointerChain* chains, size_t count, size_t pointerSize) {
+    std::vector<uintptr_t> current(count);
+    std::vector<size_t> active;
+    active.reserve(count);
+
+    for (size_t i = 0; i < count; i++) {
+        current[i] = chains[i].base;
+        chains[i].address = 0;
+        chains[i].failedLevel = -1;
+        active.push_back(i);
+    }
+
+    std::unordered_map<uintptr_t, size_t> pointerIndex;
+    std::vector<uint64_t> pointers;
+    std::vector<batchEntry> entries;
+    std::vector<size_t> entryFor(count);
+
+    for (size_t level = 0; !active.empty(); level++) {
+        pointerIndex.clear();
+        pointers.clear();
+        entries.clear();
+
+        // Sized up front so the pointers handed to the batch never move
+        pointers.resize(active.size());
+
+        for (size_t i : active) {
+            const pointerChain& chain = chains[i];
+            int64_t offset = level < chain.depth ? chain.offsets[level] : 0;
+            uintptr_t address = current[i] + offset;
+
+            if (level + 1 >= chain.depth) {
+                // Last level, read the value itself
+                chains[i].address = address;
+                entryFor[i] = entries.size();
+                entries.push_back({ address, chain.result, chain.resultSize, false });
+                continue;
+            }
+
+            auto existing = pointerIndex.find(address);
+            if (existing != pointerIndex.end()) {
+                entryFor[i] = existing->second;
+                continue;
+            }
+
+            uint64_t* pointer = &pointers[pointerIndex.size()];
+            *pointer = 0;
+            pointerIndex[address] = entries.size();
+            entryFor[i] = entries.size();
+            entries.push_back({ address, pointer, pointerSize, false });
+        }
+
+        readMemoryBatch(pid, entries.data(), entries.size());
+
+        std::vector<size_t> stillActive;
+        for (size_t i : active) {
+            const batchEntry& entry = entries[entryFor[i]];
+
+            if (level + 1 >= chains[i].depth) {
+                if (!entry.ok) {
+                    chains[i].failedLevel = (int) level;
+                }
+                continue;
+            }
+
+            // Pointers narrower than 8 bytes land in the low bytes (little endian)
+            uint64_t pointer = *(uint64_t*)entry.buffer;
+            if (!entry.ok || pointer == 0) {
+                chains[i].failedLevel = (int) level;
+                continue;
+            }
+
+            current[i] = pointer;
+            stillActive.push_back(i);
+        }
+        active.swap(stillActive);
+    }
+}
+
+memory::dataType memory::parseDataType(const char* name) {
+    if (!strcmp(name, "byte")) return T_BYTE;
+    if (!strcmp(name, "int") || !strcmp(name, "int32")) return T_INT32;
+    if (!strcmp(name, "uint32") || !strcmp(name, "dword")) return T_UINT32;
+    if (!strcmp(name, "int64")) return T_INT64;
+    if (!strcmp(name, "uint64")) return T_UINT64;
+    if (!strcmp(name, "short")) return T_SHORT;
+    if (!strcmp(name, "long")) return T_LONG;
+    if (!strcmp(name, "float")) return T_FLOAT;
+    if (!strcmp(name, "double")) return T_DOUBLE;
+    if (!strcmp(name, "ptr") || !strcmp(name, "pointer")) return T_PTR;
+    if (!strcmp(name, "bool") || !strcmp(name, "boolean")) return T_BOOL;
+    if (!strcmp(name, "vector3") || !strcmp(name, "vec3")) return T_VEC3;
+    if (!strcmp(name, "vector4") || !strcmp(name, "vec4")) return T_VEC4;
+    return T_UNKNOWN;
+}
+
+size_t memory::dataTypeSize(dataType type) {
+    switch (type) {
+        case T_BYTE: return sizeof(unsigned char);
+        case T_INT32: return sizeof(int32_t);
+        case T_UINT32: return sizeof(uint32_t);
+        case T_INT64: return sizeof(int64_t);
+        case T_UINT64: return sizeof(uint64_t);
+        case T_SHORT: return sizeof(short);
+        case T_LONG: return sizeof(long);
+        case T_FLOAT: return sizeof(float);
+        case T_DOUBLE: return sizeof(double);
+        case T_PTR: return sizeof(intptr_t);
+        case T_BOOL: return sizeof(bool);
+        case T_VEC3: return sizeof(float) * 3;
+        case T_VEC4: return sizeof(float) * 4;
+        default: return 0;
+    }
+}
@@ -7,6 +7,8 @@
 #include <cstdint>
 #include <cstring>
 #include <cerrno>
+#include <vector>
+#include <string>
 #include <sys/uio.h>
 
 class memory {
@@ -14,6 +16,68 @@ public:
   memory();
   ~memory();
 
+  // Fixed-size data types understood by the native batch read paths.
+  enum dataType {
+    T_UNKNOWN = 0,
+    T_BYTE,
+    T_INT32,
+    T_UINT32,
+    T_INT64,
+    T_UINT64,
+    T_SHORT,
+    T_LONG,
+    T_FLOAT,
+    T_DOUBLE,
+    T_PTR,
+    T_BOOL,
+    T_VEC3,
+    T_VEC4
+  };
+
+  // How reads are served for a handle.
+  // vm_readv: process_vm_readv (the default)
+  // proc_mem: pread/preadv on a /proc/<pid>/mem descriptor kept open per handle
+  enum backend {
+    B_VM_READV = 0x0,
+    B_PROC_MEM = 0x1
+  };
+
+  // One element of a scatter read. `size` bytes at `address` are copied into
+  // `buffer`; `ok` is cleared if the remote range could not be read in full.
+  struct batchEntry {
+    uintptr_t address;
+    void* buffer;
+    size_t size;
+    bool ok;
+  };
+
+  // A compiled struct layout; every field is decoded from one contiguous read of `size` bytes.
+  struct structLayout {
+    struct field {
+      std::string name;
+      dataType type;
+      size_t offset;
+    };
+
+    std::vector<field> fields;
+    size_t size;
+  };
+
+  // A pointer path [[base + offsets[0]] + offsets[1]] ... + offsets[depth - 1]. Every
+  // offset but the last is followed by a pointer dereference, the last one locates
+  // the `resultSize` byte value copied into `result`. On return `address` holds the
+  // value's address and `failedLevel` is -1, or the index of the offset whose
+  // dereference was unreadable or null.
+  struct pointerChain {
+    uintptr_t base;
+    const int64_t* offsets;
+    size_t depth;
+    void* result;
+    size_t resultSize;
+    uintptr_t address;
+    int failedLevel;
+  };
+
   template <class dataType>
   dataType readMemory(pid_t hProcess, uintptr_t address) {
     dataType cRead;
@@ -34,5 +98,42 @@ public:
   }
 
   void readMemoryData(pid_t pid, uintptr_t address, void *buffer, size_t size);
+
+  // Like readMemoryData, but keeps whatever could be read. Unreadable pages are
+  // zeroed and skipped one at a time while the rest is read in bulk. If `validPages`
+  // is given it receives one bit per page touched by the range (LSB first, bit 0 is
+  // the page containing `address`). Returns the number of bytes that were read.
+  size_t readMemoryPartial(pid_t pid, uintptr_t address, void *buffer, size_t size, std::vector<uint8_t>* validPages);
+
+  // Reads a null-terminated string a page-bounded chunk at a time, stopping at the
+  // terminator, at the first unreadable byte or after `maxLength` characters.
+  // Returns false if `maxLength` characters were read without finding an end.
+  bool readString(pid_t pid, uintptr_t address, size_t maxLength, std::string* result);
+
+  // Reads every entry using as few process_vm_readv calls as possible (up to
+  // IOV_MAX iovecs per call). Returns the number of entries read successfully.
+  size_t readMemoryBatch(pid_t pid, batchEntry* entries, size_t count);
+
+  // Selects the backend for one handle. Switching to B_PROC_MEM opens the
+  // descriptor straight away so failures can be reported to the caller.
+  static bool setBackend(pid_t pid, backend type, const char** errorMessage);
+  // Selects the backend for every handle that has not been given one explicitly.
+  static void setDefaultBackend(backend type);
+  static backend getBackend(pid_t pid);
+  // Forgets the handle's backend and closes its /proc/<pid>/mem descriptor, if any.
+  static void closeHandle(pid_t pid);
+
+  // Walks every chain level by level, sharing one batched read per level between all
+  // of them; pointers are `pointerSize` (4 or 8) bytes wide. Dereferences of the same
+  // address (e.g. a shared prefix) are only read once.
+  void readPointerChains(pid_t pid, pointerChain* chains, size_t count, size_t pointerSize);
+
+  static dataType parseDataType(const char* name);
+  static size_t dataTypeSize(dataType type);
+  static size_t pageSize();
+
+private:
+  // Single read of up to `size` bytes; returns the bytes read or -1 like process_vm_readv.
+  ssize_t readRaw(pid_t pid, uintptr_t address, void *buffer, size_t size);
 };
 #endif
@@ -1,10 +1,21 @@
 #include <napi.h>
 #include <cstdlib>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <algorithm>
 #include "module.h"
 #include "process.h"
 #include "memoryjs.h"
 #include "memory.h"
 #include "pattern.h"
+#include "watcher.h"
+#include "scanner.h"
+#include "signaturecache.h"
+#include "valuescanner.h"
+#include "scansession.h"
+#include "spillbuffer.h"
+#include "pointerscanner.h"
 
 process Process;
 pattern Pattern;
@@ -21,6 +32,142 @@ struct Vector4
   float w, x, y, z;
 };
 
+// Externals handed to JS are tagged with their kind, so that an External of another kind
+// (or from another addon) passed back in is rejected instead of reinterpreted
+const napi_type_tag structLayoutTag = {0x6d656d6f72796a73, 0x0000000000000001};
+const napi_type_tag cancelTokenTag = {0x6d656d6f72796a73, 0x0000000000000002};
+const napi_type_tag watcherTag = {0x6d656d6f72796a73, 0x0000000000000003};
+const napi_type_tag scanSessionTag = {0x6d656d6f72796a73, 0x0000000000000004};
+const napi_type_tag pointerMapTag = {0x6d656d6f72796a73, 0x0000000000000005};
+
+Napi::Value tagExternal(Napi::Env env, Napi::Value external, const napi_type_tag &tag)
+{
+  napi_type_tag_object(env, external, &tag);
+  return external;
+}
+
+bool isTagged(Napi::Env env, Napi::Value value, const napi_type_tag &tag)
+{
+  bool tagged = false;
+  return value.IsExternal() && napi_check_object_type_tag(env, value, &tag, &tagged) == napi_ok && tagged;
+}
+
+// Converts raw bytes read from the target into the same JS values `readMemory` returns.
+Napi::Value decodeValue(Napi::Env env, memory::dataType type, const void *data)
+{
+  switch (type)
+  {
+  case memory::T_BYTE:
+    return Napi::Value::From(env, *(const unsigned char *)data);
+  case memory::T_INT32:
+    return Napi::Value::From(env, *(const int32_t *)data);
+  case memory::T_UINT32:
+    return Napi::Value::From(env, *(const uint32_t *)data);
+  case memory::T_INT64:
+    return Napi::Value::From(env, *(const int64_t *)data);
+  case memory::T_UINT64:
+    return Napi::Value::From(env, *(const uint64_t *)data);
+  case memory::T_SHORT:
+    return Napi::Value::From(env, *(const short *)data);
+  case memory::T_LONG:
+    return Napi::Value::From(env, *(const long *)data);
+  case memory::T_FLOAT:
+    return Napi::Value::From(env, *(const float *)data);
+  case memory::T_DOUBLE:
+    return Napi::Value::From(env, *(const double *)data);
+  case memory::T_PTR:
+    return Napi::Value::From(env, *(const intptr_t *)data);
+  case memory::T_BOOL:
+    return Napi::Boolean::New(env, *(const bool *)data);
+  case memory::T_VEC3:
+  {
+    const Vector3 *vector = (const Vector3 *)data;
+    Napi::Object result = Napi::Object::New(env);
+    result.Set(Napi::String::New(env, "x"), Napi::Value::From(env, vector->x));
+    result.Set(Napi::String::New(env, "y"), Napi::Value::From(env, vector->y));
+    result.Set(Napi::String::New(env, "z"), Napi::Value::From(env, vector->z));
+    return result;
+  }
+  case memory::T_VEC4:
+  {
+    const Vector4 *vector = (const Vector4 *)data;
+    Napi::Object result = Napi::Object::New(env);
+    result.Set(Napi::String::New(env, "w"), Napi::Value::From(env, vector->w));
+    result.Set(Napi::String::New(env, "x"), Napi::Value::From(env, vector->x));
+    result.Set(Napi::String::New(env, "y"), Napi::Value::From(env, vector->y));
+    result.Set(Napi::String::New(env, "z"), Napi::Value::From(env, vector->z));
+    return result;
+  }
+  default:
+    return env.Null();
+  }
+}
+
+// The inverse of decodeValue for the scalar types: stores `value` as `type` is laid out in the target
+bool encodeValue(Napi::Env env, memory::dataType type, Napi::Value value, void *data)
+{
+  bool lossless;
+  int64_t integer;
+  double number;
+
+  if (value.IsBigInt())
+  {
+    integer = value.As<Napi::BigInt>().Int64Value(&lossless);
+    number = (double)integer;
+  }
+  else if (value.IsNumber())
+  {
+    number = value.As<Napi::Number>().DoubleValue();
+    integer = value.As<Napi::Number>().Int64Value();
+  }
+  else if (value.IsBoolean())
+  {
+    integer = value.As<Napi::Boolean>().Value() ? 1 : 0;
+    number = (double)integer;
+  }
+  else
+  {
+    Napi::Error::New(env, "value must be a number, a BigInt or a boolean").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  switch (type)
+  {
+  case memory::T_BYTE:
+    *(unsigned char *)data = (unsigned char)integer;
+    return true;
+  case memory::T_BOOL:
+    *(bool *)data = integer != 0;
+    return true;
+  case memory::T_SHORT:
+    *(short *)data = (short)integer;
+    return true;
+  case memory::T_INT32:
+  case memory::T_UINT32:
+    *(uint32_t *)data = (uint32_t)integer;
+    return true;
+  case memory::T_INT64:
+  case memory::T_UINT64:
+    *(uint64_t *)data = (uint64_t)integer;
+    return true;
+  case memory::T_LONG:
+    *(long *)data = (long)integer;
+    return true;
+  case memory::T_PTR:
+    *(intptr_t *)data = (intptr_t)integer;
+    return true;
+  case memory::T_FLOAT:
+    *(float *)data = (float)number;
+    return true;
+  case memory::T_DOUBLE:
+    *(double *)data = number;
+    return true;
+  default:
+    Napi::Error::New(env, "unsupported data type").ThrowAsJavaScriptException();
+    return false;
+  }
+}
+
 Napi::Value openProcess(const Napi::CallbackInfo &args)
 {
   Napi::Env env = args.Env();
@@ -161,6 +308,166 @@ Napi::Value getProcesses(const Napi::CallbackInfo &args)
 Napi::Value closeProcess(const Napi::CallbackInfo &args)
 {
   Napi::Env env = args.Env();
+
+  // Handles are pids, the only things to release are per-handle read state and the region map
+  if (args.Length() >= 1 && args[0].IsNumber())
+  {
+    pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+    memory::closeHandle(handle);
+    module::releaseRegionMap(handle);
+  }
+
+  return env.Null();
+}
+
+Napi::Value setReadBackend(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 1 && args.Length() != 2)
+  {
+    Napi::Error::New(env, "requires 1 argument, or 2 arguments if a handle is given").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!args[0].IsNumber() || (args.Length() == 2 && !args[1].IsNumber()))
+  {
+    Napi::Error::New(env, "all arguments must be numbers").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  uint32_t backend = args[args.Length() - 1].As<Napi::Number>().Uint32Value();
+  if (backend != memory::B_VM_READV && backend != memory::B_PROC_MEM)
+  {
+    Napi::Error::New(env, "unexpected read backend").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  // Without a handle, the backend becomes the default for every handle
+  if (args.Length() == 1)
+  {
+    memory::setDefaultBackend((memory::backend)backend);
+    return env.Null();
+  }
+
+  const char *errorMessage = "";
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+
+  if (!memory::setBackend(handle, (memory::backend)backend, &errorMessage))
+  {
+    Napi::Error::New(env, errorMessage).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  return env.Null();
+}
+
+Napi::Value getReadBackend(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 1 || !args[0].IsNumber())
+  {
+    Napi::Error::New(env, "requires 1 argument, the handle").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  return Napi::Value::From(env, (uint32_t)memory::getBackend(handle));
+}
+
+Napi::Value setScanOptions(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 1 || !args[0].IsObject())
+  {
+    Napi::Error::New(env, "requires 1 argument, an options object").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Object options = args[0].As<Napi::Object>();
+  scanner::options scanOptions = scanner::getOptions();
+  spillBuffer::options sessionOptions = spillBuffer::getOptions();
+
+  // Keys that are missing keep their current value, 0 restores the default
+  const char *keys[] = { "maxMemory", "chunkSize", "threads", "sessionMemory" };
+  size_t *values[] = { &scanOptions.maxMemory, &scanOptions.chunkSize, &scanOptions.threads, &sessionOptions.memoryLimit };
+
+  for (size_t i = 0; i < 4; i++)
+  {
+    if (!options.Has(keys[i])) continue;
+
+    Napi::Value value = options.Get(keys[i]);
+    if (!value.IsNumber() || value.As<Napi::Number>().DoubleValue() < 0)
+    {
+      Napi::Error::New(env, std::string(keys[i]) + " must be a positive number").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    *values[i] = (size_t)value.As<Napi::Number>().Int64Value();
+  }
+
+  // An empty string restores the default, $TMPDIR or /tmp
+  if (options.Has("tempDirectory"))
+  {
+    Napi::Value value = options.Get("tempDirectory");
+    if (!value.IsString())
+    {
+      Napi::Error::New(env, "tempDirectory must be a string").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    sessionOptions.directory = value.As<Napi::String>().Utf8Value();
+  }
+
+  scanner::setOptions(scanOptions);
+  spillBuffer::setOptions(sessionOptions);
+  return env.Null();
+}
+
+Napi::Value getScanOptions(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+  scanner::options scanOptions = scanner::getOptions();
+
+  Napi::Object options = Napi::Object::New(env);
+  options.Set(Napi::String::New(env, "maxMemory"), Napi::Value::From(env, (double)scanOptions.maxMemory));
+  options.Set(Napi::String::New(env, "chunkSize"), Napi::Value::From(env, (double)scanner::chunkSize()));
+  options.Set(Napi::String::New(env, "threads"), Napi::Value::From(env, (double)scanner::threadCount()));
+
+  spillBuffer::options sessionOptions = spillBuffer::getOptions();
+  options.Set(Napi::String::New(env, "sessionMemory"), Napi::Value::From(env, (double)sessionOptions.memoryLimit));
+  options.Set(Napi::String::New(env, "tempDirectory"), Napi::String::New(env, sessionOptions.directory));
+  return options;
+}
+
+Napi::Value setSignatureCache(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  // Without a path (or with null) the cache is turned off
+  if (args.Length() == 0 || args[0].IsNull() || args[0].IsUndefined())
+  {
+    signatureCache::close();
+    return env.Null();
+  }
+
+  if (!args[0].IsString())
+  {
+    Napi::Error::New(env, "first argument must be a string, the cache file path").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  const char *errorMessage = "";
+  std::string path(args[0].As<Napi::String>().Utf8Value());
+
+  if (!signatureCache::open(path.c_str(), &errorMessage))
+  {
+    Napi::Error::New(env, errorMessage).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
   return env.Null();
 }
 
@@ -227,337 +534,2897 @@ Napi::Value findModule(const Napi::CallbackInfo &args)
   }
 }
 
-Napi::Value findPattern(const Napi::CallbackInfo &args)
+Napi::Value getModules(const Napi::CallbackInfo &args)
 {
   Napi::Env env = args.Env();
 
-  // Address of findPattern result
-  uintptr_t address = -1;
+  if (args.Length() != 1 && args.Length() != 2)
+  {
+    Napi::Error::New(env, "requires 1 argument, or 2 arguments if a callback is being used").ThrowAsJavaScriptException();
+    return env.Null();
+  }
 
-  // Define error message that may be set by the function that gets the modules
-  const char *errorMessage = "";
+  if (!args[0].IsNumber())
+  {
+    Napi::Error::New(env, "first argument must be a number").ThrowAsJavaScriptException();
+    return env.Null();
+  }
 
-  pid_t hProcess = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  if (args.Length() == 2 && !args[1].IsFunction())
+  {
+    Napi::Error::New(env, "second argument must be a function").ThrowAsJavaScriptException();
+    return env.Null();
+  }
 
-  std::vector<module::Module> moduleEntries = module::getModules(hProcess, &errorMessage);
+  const char *errorMessage = "";
+  pid_t processId = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  std::shared_ptr<const module::RegionTable> table;
+  std::vector<module::Region> moduleEntries = module::getModules(processId, &errorMessage, &table);
 
-  // If en error message was returned from the function getting the modules, throw the error.
+  // If an error message was returned from the function getting the modules, throw the error.
   // Only throw an error if there is no callback (if there's a callback, the error is passed there).
-  if (strcmp(errorMessage, "") && args.Length() != 7)
+  if (strcmp(errorMessage, "") && args.Length() != 2)
   {
     Napi::Error::New(env, errorMessage).ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  uintptr_t baseAddress = 0;
-  for (std::vector<module::Module>::size_type i = 0; i != moduleEntries.size(); i++)
-  {
-    std::string moduleName(args[1].As<Napi::String>().Utf8Value());
-
-    char *match = strstr(moduleEntries[i].pathname, moduleName.c_str());
-    if (match != NULL)
-    {
-      if (baseAddress == 0)
-      {
-        baseAddress = moduleEntries[i].start;
-      }
-      std::string signature(args[2].As<Napi::String>().Utf8Value());
-
-      short sigType = args[3].As<Napi::Number>().Int32Value();
-      uint32_t patternOffset = args[4].As<Napi::Number>().Int32Value();
-      uint32_t addressOffset = args[5].As<Napi::Number>().Int32Value();
-      uint32_t skip = args[6].As<Napi::Number>().Int32Value();
+  // A module spans its consecutive mappings, which all carry its path
+  Napi::Array modules = Napi::Array::New(env);
+  uint32_t count = 0;
 
-      address = Pattern.findPattern(hProcess, moduleEntries[i], baseAddress, signature.c_str(), sigType, patternOffset, addressOffset, skip);
-      if (address != (uintptr_t)-2)
-      {
-        break;
-      }
-    }
+  for (size_t i = 0; i < moduleEntries.size();)
+  {
+    size_t last = i;
+    while (last + 1 < moduleEntries.size() && moduleEntries[last + 1].path == moduleEntries[i].path)
+      last++;
+
+    const char *pathname = module::modulePath(*table, moduleEntries[i]);
+    const char *fileName = strrchr(pathname, '/');
+
+    Napi::Object module = Napi::Object::New(env);
+    module.Set(Napi::String::New(env, "modBaseAddr"), Napi::Value::From(env, moduleEntries[i].start));
+    module.Set(Napi::String::New(env, "modBaseSize"), Napi::Value::From(env, moduleEntries[last].end - moduleEntries[i].start));
+    module.Set(Napi::String::New(env, "szExePath"), Napi::String::New(env, pathname));
+    module.Set(Napi::String::New(env, "szModule"), Napi::String::New(env, fileName != NULL ? fileName + 1 : pathname));
+    module.Set(Napi::String::New(env, "th32ProcessID"), Napi::Value::From(env, (int)processId));
+    modules.Set(count++, module);
+
+    i = last + 1;
   }
 
-  // If no error was set by getModules and the address is still the value we set it as, it probably means we couldn't find the module
-  if (strcmp(errorMessage, "") && address == (uintptr_t)-1)
-    errorMessage = "unable to find module";
-
-  // If no error was set by getModules and the addressis -2 this means there was no match to the pattern
-  if (strcmp(errorMessage, "") && address == (uintptr_t)-2)
-    errorMessage = "no match found";
-
-  if (args.Length() == 8)
+  if (args.Length() == 2)
   {
-    // Callback to let the user handle the information
-    Napi::Function callback = args[7].As<Napi::Function>();
-    callback.Call(env.Global(), {Napi::String::New(env, errorMessage), Napi::Value::From(env, address)});
+    Napi::Function callback = args[1].As<Napi::Function>();
+    callback.Call(env.Global(), {Napi::String::New(env, errorMessage), modules});
     return env.Null();
   }
   else
   {
-    // return JSON
-    return Napi::Value::From(env, address);
+    return modules;
   }
 }
 
-Napi::Value readMemory(const Napi::CallbackInfo &args)
+Napi::Value getRegions(const Napi::CallbackInfo &args)
 {
   Napi::Env env = args.Env();
 
-  if (args.Length() != 3 && args.Length() != 4)
+  if (args.Length() != 1 && args.Length() != 2)
   {
-    Napi::Error::New(env, "requires 3 arguments, or 4 arguments if a callback is being used").ThrowAsJavaScriptException();
+    Napi::Error::New(env, "requires 1 argument, or 2 arguments if a callback is being used").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  if (!args[0].IsNumber() && !args[1].IsNumber() && !args[2].IsString())
+  if (!args[0].IsNumber())
   {
-    Napi::Error::New(env, "first and second argument must be a number, third argument must be a string").ThrowAsJavaScriptException();
+    Napi::Error::New(env, "first argument must be a number").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  if (args.Length() == 4 && !args[3].IsFunction())
+  if (args.Length() == 2 && !args[1].IsFunction())
   {
-    Napi::Error::New(env, "fourth argument must be a function").ThrowAsJavaScriptException();
+    Napi::Error::New(env, "second argument must be a function").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  std::string dataTypeArg(args[2].As<Napi::String>().Utf8Value());
-  const char *dataType = dataTypeArg.c_str();
-
-  // Define the error message that will be set if no data type is recognised
-  std::string errorMessage;
-  Napi::Value retVal = env.Null();
-
+  const char *errorMessage = "";
   pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
-  uintptr_t address = args[1].As<Napi::Number>().Int64Value();
+  std::shared_ptr<const module::RegionTable> table = module::getRegionMap(handle, &errorMessage);
 
-  if (!strcmp(dataType, "byte"))
+  if (strcmp(errorMessage, "") && args.Length() != 2)
   {
-
-    unsigned char result = Memory.readMemory<unsigned char>(handle, address);
-    retVal = Napi::Value::From(env, result);
+    Napi::Error::New(env, errorMessage).ThrowAsJavaScriptException();
+    return env.Null();
   }
-  else if (!strcmp(dataType, "int"))
-  {
 
-    int result = Memory.readMemory<int>(handle, address);
-    retVal = Napi::Value::From(env, result);
-  }
-  else if (!strcmp(dataType, "int32"))
-  {
+  Napi::Array regionsArray = Napi::Array::New(env, table->regions.size());
 
-    int32_t result = Memory.readMemory<int32_t>(handle, address);
-    retVal = Napi::Value::From(env, result);
-  }
-  else if (!strcmp(dataType, "uint32"))
+  for (size_t i = 0; i < table->regions.size(); i++)
   {
+    const module::Region &entry = table->regions[i];
 
-    uint32_t result = Memory.readMemory<uint32_t>(handle, address);
-    retVal = Napi::Value::From(env, result);
-  }
-  else if (!strcmp(dataType, "int64"))
-  {
+    char permissions[5];
+    module::permissionString(entry.permissions, permissions);
 
-    int64_t result = Memory.readMemory<int64_t>(handle, address);
-    retVal = Napi::Value::From(env, result);
+    Napi::Object region = Napi::Object::New(env);
+    region.Set(Napi::String::New(env, "BaseAddress"), Napi::Value::From(env, entry.start));
+    region.Set(Napi::String::New(env, "RegionSize"), Napi::Value::From(env, entry.end - entry.start));
+    region.Set(Napi::String::New(env, "Protect"), Napi::String::New(env, permissions));
+    region.Set(Napi::String::New(env, "Offset"), Napi::Value::From(env, (double)entry.offset));
+    region.Set(Napi::String::New(env, "Inode"), Napi::Value::From(env, (double)entry.inode));
+
+    // [heap], [stack] and file paths; anonymous mappings have none
+    if (entry.path != 0)
+      region.Set(Napi::String::New(env, "szExeFile"), Napi::String::New(env, table->pathname(entry)));
+
+    regionsArray.Set(i, region);
   }
-  else if (!strcmp(dataType, "uint64"))
-  {
 
-    uint64_t result = Memory.readMemory<uint64_t>(handle, address);
-    retVal = Napi::Value::From(env, result);
+  if (args.Length() == 2)
+  {
+    Napi::Function callback = args[1].As<Napi::Function>();
+    callback.Call(env.Global(), {Napi::String::New(env, errorMessage), regionsArray});
+    return env.Null();
   }
-  else if (!strcmp(dataType, "dword"))
+  else
   {
+    return regionsArray;
+  }
+}
 
-    uint32_t result = Memory.readMemory<uint32_t>(handle, address);
-    retVal = Napi::Value::From(env, result);
+// Reads one address given as a number or a BigInt
+bool parseAddress(Napi::Env env, Napi::Value value, uintptr_t *address)
+{
+  bool lossless;
+
+  if (value.IsNumber())
+    *address = (uintptr_t)value.As<Napi::Number>().Int64Value();
+  else if (value.IsBigInt())
+    *address = (uintptr_t)value.As<Napi::BigInt>().Uint64Value(&lossless);
+  else
+  {
+    Napi::Error::New(env, "every address must be a number or a BigInt").ThrowAsJavaScriptException();
+    return false;
   }
-  else if (!strcmp(dataType, "short"))
+
+  return true;
+}
+
+// Reads a list of addresses given as an array of numbers or BigInts, or as a BigUint64Array
+bool parseAddresses(Napi::Env env, Napi::Value value, std::vector<uintptr_t> &addresses)
+{
+  if (value.IsTypedArray() && value.As<Napi::TypedArray>().TypedArrayType() == napi_biguint64_array)
   {
+    Napi::BigUint64Array array = value.As<Napi::BigUint64Array>();
+    addresses.assign(array.Data(), array.Data() + array.ElementLength());
+    return true;
+  }
 
-    short result = Memory.readMemory<short>(handle, address);
-    retVal = Napi::Value::From(env, result);
+  if (!value.IsArray())
+  {
+    Napi::Error::New(env, "addresses must be an array or a BigUint64Array").ThrowAsJavaScriptException();
+    return false;
   }
-  else if (!strcmp(dataType, "long"))
+
+  Napi::Array array = value.As<Napi::Array>();
+  addresses.resize(array.Length());
+
+  for (uint32_t i = 0; i < array.Length(); i++)
   {
+    if (!parseAddress(env, array.Get(i), &addresses[i]))
+    {
+      return false;
+    }
+  }
 
-    long result = Memory.readMemory<long>(handle, address);
-    retVal = Napi::Value::From(env, result);
+  return true;
+}
+
+Napi::Value findRegionForAddress(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 2 || !args[0].IsNumber())
+  {
+    Napi::Error::New(env, "requires 2 arguments, the handle and an array of addresses").ThrowAsJavaScriptException();
+    return env.Null();
   }
-  else if (!strcmp(dataType, "float"))
+
+  std::vector<uintptr_t> addresses;
+  if (!parseAddresses(env, args[1], addresses))
   {
+    return env.Null();
+  }
 
-    float result = Memory.readMemory<float>(handle, address);
-    retVal = Napi::Value::From(env, result);
+  const char *errorMessage = "";
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  std::shared_ptr<const module::RegionTable> table = module::getRegionMap(handle, &errorMessage);
+
+  if (strcmp(errorMessage, ""))
+  {
+    Napi::Error::New(env, errorMessage).ThrowAsJavaScriptException();
+    return env.Null();
   }
-  else if (!strcmp(dataType, "double"))
+
+  const size_t count = addresses.size();
+  std::vector<int32_t> found(count);
+  module::findRegions(*table, addresses.data(), count, found.data());
+
+  Napi::Int32Array index = Napi::Int32Array::New(env, count);
+  Napi::BigUint64Array base = Napi::BigUint64Array::New(env, count);
+  Napi::BigUint64Array offset = Napi::BigUint64Array::New(env, count);
+  Napi::Uint32Array path = Napi::Uint32Array::New(env, count);
+
+  for (size_t i = 0; i < count; i++)
   {
+    index[i] = found[i];
+    if (found[i] < 0)
+    {
+      base[i] = 0;
+      offset[i] = 0;
+      path[i] = 0;
+      continue;
+    }
 
-    double result = Memory.readMemory<double>(handle, address);
-    retVal = Napi::Value::From(env, result);
+    // Offsets are from the start of the module, so they stay valid across runs
+    const module::Region &moduleBase = table->regions[module::moduleStart(*table, found[i])];
+    base[i] = moduleBase.start;
+    offset[i] = addresses[i] - moduleBase.start;
+    path[i] = moduleBase.path;
   }
-  else if (!strcmp(dataType, "ptr") || !strcmp(dataType, "pointer"))
+
+  Napi::Array paths = Napi::Array::New(env, table->paths.size());
+  for (size_t i = 0; i < table->paths.size(); i++)
   {
+    paths.Set(i, Napi::String::New(env, table->paths[i]));
+  }
 
-    intptr_t result = Memory.readMemory<intptr_t>(handle, address);
-    retVal = Napi::Value::From(env, result);
+  Napi::Object result = Napi::Object::New(env);
+  result.Set(Napi::String::New(env, "index"), index);
+  result.Set(Napi::String::New(env, "base"), base);
+  result.Set(Napi::String::New(env, "offset"), offset);
+  result.Set(Napi::String::New(env, "path"), path);
+  result.Set(Napi::String::New(env, "paths"), paths);
+  return result;
+}
+
+// Like getRegions, but column by column: one typed array per field and one string per distinct path
+Napi::Value getRegionTable(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 1 || !args[0].IsNumber())
+  {
+    Napi::Error::New(env, "requires 1 argument, the handle").ThrowAsJavaScriptException();
+    return env.Null();
   }
-  else if (!strcmp(dataType, "bool") || !strcmp(dataType, "boolean"))
+
+  const char *errorMessage = "";
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  std::shared_ptr<const module::RegionTable> table = module::getRegionMap(handle, &errorMessage);
+
+  if (strcmp(errorMessage, ""))
   {
+    Napi::Error::New(env, errorMessage).ThrowAsJavaScriptException();
+    return env.Null();
+  }
 
-    bool result = Memory.readMemory<bool>(handle, address);
-    retVal = Napi::Boolean::New(env, result);
+  const size_t count = table->regions.size();
+  Napi::BigUint64Array start = Napi::BigUint64Array::New(env, count);
+  Napi::BigUint64Array end = Napi::BigUint64Array::New(env, count);
+  Napi::BigUint64Array offset = Napi::BigUint64Array::New(env, count);
+  Napi::BigUint64Array inode = Napi::BigUint64Array::New(env, count);
+  Napi::Uint32Array dev = Napi::Uint32Array::New(env, count);
+  Napi::Uint32Array path = Napi::Uint32Array::New(env, count);
+  Napi::Uint8Array permissions = Napi::Uint8Array::New(env, count);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    const module::Region &region = table->regions[i];
+    start[i] = region.start;
+    end[i] = region.end;
+    offset[i] = region.offset;
+    inode[i] = region.inode;
+    dev[i] = region.dev;
+    path[i] = region.path;
+    permissions[i] = (uint8_t)region.permissions;
   }
-  else if (!strcmp(dataType, "string") || !strcmp(dataType, "str"))
+
+  Napi::Array paths = Napi::Array::New(env, table->paths.size());
+  for (size_t i = 0; i < table->paths.size(); i++)
   {
+    paths.Set(i, Napi::String::New(env, table->paths[i]));
+  }
 
-    std::vector<char> chars;
-    int offset = 0x0;
-    while (true)
-    {
-      char c = Memory.readChar(handle, address + offset);
-      chars.push_back(c);
+  Napi::Object result = Napi::Object::New(env);
+  result.Set(Napi::String::New(env, "count"), Napi::Value::From(env, (double)count));
+  result.Set(Napi::String::New(env, "start"), start);
+  result.Set(Napi::String::New(env, "end"), end);
+  result.Set(Napi::String::New(env, "offset"), offset);
+  result.Set(Napi::String::New(env, "inode"), inode);
+  result.Set(Napi::String::New(env, "dev"), dev);
+  result.Set(Napi::String::New(env, "permissions"), permissions);
+  result.Set(Napi::String::New(env, "path"), path);
+  result.Set(Napi::String::New(env, "paths"), paths);
+  return result;
+}
 
-      // break at 1 million chars
-      if (offset == (sizeof(char) * 1000000))
-      {
-        chars.clear();
-        break;
-      }
+Napi::Value findPattern(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
 
-      // break at terminator (end of string)
-      if (c == '\0')
-      {
-        break;
-      }
+  // Address of findPattern result
+  uintptr_t address = -1;
 
-      // go to next char
-      offset += sizeof(char);
-    }
+  // Define error message that may be set by the function that gets the modules
+  const char *errorMessage = "";
 
-    if (chars.size() == 0)
-    {
+  pid_t hProcess = (pid_t)args[0].As<Napi::Number>().Int64Value();
 
-      if (args.Length() == 4)
-        errorMessage = "unable to read string (no null-terminator found after 1 million chars)";
-      else
-      {
-        Napi::Error::New(env, "unable to read string (no null-terminator found after 1 million chars)").ThrowAsJavaScriptException();
-        return env.Null();
-      }
+  std::string moduleName(args[1].As<Napi::String>().Utf8Value());
+  std::string signature(args[2].As<Napi::String>().Utf8Value());
+  short sigType = args[3].As<Napi::Number>().Int32Value();
+  uint32_t patternOffset = args[4].As<Napi::Number>().Int32Value();
+  uint32_t addressOffset = args[5].As<Napi::Number>().Int32Value();
+  uint32_t skip = args[6].As<Napi::Number>().Int32Value();
+
+  address = Pattern.findPatternInModule(hProcess, moduleName.c_str(), signature.c_str(), sigType, patternOffset, addressOffset, skip, &errorMessage);
+
+  // If en error message was returned from the function getting the modules, throw the error.
+  // Only throw an error if there is no callback (if there's a callback, the error is passed there).
+  if (strcmp(errorMessage, "") && args.Length() != 7)
+  {
+    Napi::Error::New(env, errorMessage).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  // If no error was set by getModules and the address is still the value we set it as, it probably means we couldn't find the module
+  if (strcmp(errorMessage, "") && address == (uintptr_t)-1)
+    errorMessage = "unable to find module";
+
+  // If no error was set by getModules and the addressis -2 this means there was no match to the pattern
+  if (strcmp(errorMessage, "") && address == (uintptr_t)-2)
+    errorMessage = "no match found";
+
+  if (args.Length() == 8)
+  {
+    // Callback to let the user handle the information
+    Napi::Function callback = args[7].As<Napi::Function>();
+    callback.Call(env.Global(), {Napi::String::New(env, errorMessage), Napi::Value::From(env, address)});
+    return env.Null();
+  }
+  else
+  {
+    // return JSON
+    return Napi::Value::From(env, address);
+  }
+}
+
+// Parses findPatterns' signature list, each entry either a signature string or an object
+// of the form { signature, signatureType, patternOffset, addressOffset, skip }
+bool parsePatternRequests(Napi::Env env, Napi::Value value, std::vector<pattern::request> &requests)
+{
+  if (!value.IsArray())
+  {
+    Napi::Error::New(env, "signatures must be an array").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  Napi::Array signatures = value.As<Napi::Array>();
+  requests.resize(signatures.Length());
+
+  for (uint32_t i = 0; i < signatures.Length(); i++)
+  {
+    Napi::Value entry = signatures.Get(i);
+    Napi::Value signature = entry;
+    pattern::request &request = requests[i];
+    request.sigType = pattern::ST_NORMAL;
+    request.patternOffset = 0;
+    request.addressOffset = 0;
+    request.skip = 0;
+
+    if (entry.IsObject())
+    {
+      Napi::Object options = entry.As<Napi::Object>();
+      signature = options.Get("signature");
+
+      Napi::Value sigType = options.Get("signatureType");
+      Napi::Value patternOffset = options.Get("patternOffset");
+      Napi::Value addressOffset = options.Get("addressOffset");
+      Napi::Value skip = options.Get("skip");
+
+      if (sigType.IsNumber())
+        request.sigType = sigType.As<Napi::Number>().Int32Value();
+      if (patternOffset.IsNumber())
+        request.patternOffset = patternOffset.As<Napi::Number>().Int32Value();
+      if (addressOffset.IsNumber())
+        request.addressOffset = addressOffset.As<Napi::Number>().Int32Value();
+      if (skip.IsNumber())
+        request.skip = skip.As<Napi::Number>().Int32Value();
     }
-    else
+
+    if (!signature.IsString())
     {
-      // vector -> string
-      std::string str(chars.begin(), chars.end());
+      Napi::Error::New(env, "every signature must be a string or an object with a signature string").ThrowAsJavaScriptException();
+      return false;
+    }
 
-      retVal = Napi::String::New(env, str.c_str());
+    std::string sig(signature.As<Napi::String>().Utf8Value());
+    if (!pattern::compileSignature(sig.c_str(), &request.sig))
+    {
+      Napi::Error::New(env, "invalid signature").ThrowAsJavaScriptException();
+      return false;
     }
   }
-  else if (!strcmp(dataType, "vector3") || !strcmp(dataType, "vec3"))
+
+  return true;
+}
+
+// One result per signature, null where there was no match
+Napi::Array patternResults(Napi::Env env, const std::vector<uintptr_t> &results)
+{
+  Napi::Array addresses = Napi::Array::New(env, results.size());
+  for (size_t i = 0; i < results.size(); i++)
   {
+    addresses.Set(i, results[i] == (uintptr_t)-2 ? env.Null() : Napi::Value::From(env, results[i]));
+  }
+  return addresses;
+}
 
-    Vector3 result = Memory.readMemory<Vector3>(handle, address);
-    Napi::Object moduleInfo = Napi::Object::New(env);
-    moduleInfo.Set(Napi::String::New(env, "x"), Napi::Value::From(env, result.x));
-    moduleInfo.Set(Napi::String::New(env, "y"), Napi::Value::From(env, result.y));
-    moduleInfo.Set(Napi::String::New(env, "z"), Napi::Value::From(env, result.z));
+Napi::Value findPatterns(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
 
-    retVal = moduleInfo;
+  if (args.Length() != 3 && args.Length() != 4)
+  {
+    Napi::Error::New(env, "requires 3 arguments, or 4 arguments if a callback is being used").ThrowAsJavaScriptException();
+    return env.Null();
   }
-  else if (!strcmp(dataType, "vector4") || !strcmp(dataType, "vec4"))
+
+  if (!args[0].IsNumber() || !args[1].IsString())
   {
+    Napi::Error::New(env, "first argument must be a number, second argument must be a string").ThrowAsJavaScriptException();
+    return env.Null();
+  }
 
-    Vector4 result = Memory.readMemory<Vector4>(handle, address);
-    Napi::Object moduleInfo = Napi::Object::New(env);
-    moduleInfo.Set(Napi::String::New(env, "w"), Napi::Value::From(env, result.w));
-    moduleInfo.Set(Napi::String::New(env, "x"), Napi::Value::From(env, result.x));
-    moduleInfo.Set(Napi::String::New(env, "y"), Napi::Value::From(env, result.y));
-    moduleInfo.Set(Napi::String::New(env, "z"), Napi::Value::From(env, result.z));
+  if (args.Length() == 4 && !args[3].IsFunction())
+  {
+    Napi::Error::New(env, "fourth argument must be a function").ThrowAsJavaScriptException();
+    return env.Null();
+  }
 
-    retVal = moduleInfo;
+  std::vector<pattern::request> requests;
+  if (!parsePatternRequests(env, args[2], requests))
+  {
+    return env.Null();
   }
-  else
+
+  const char *errorMessage = "";
+  pid_t hProcess = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  std::string moduleName(args[1].As<Napi::String>().Utf8Value());
+
+  std::vector<uintptr_t> results;
+  if (!Pattern.findPatternsInModule(hProcess, moduleName.c_str(), requests, results, &errorMessage) && !strcmp(errorMessage, ""))
   {
+    errorMessage = "unable to find module";
+  }
 
-    if (args.Length() == 4)
-      errorMessage = "unexpected data type";
-    else
-    {
-      Napi::Error::New(env, "unexpected data type").ThrowAsJavaScriptException();
-      return env.Null();
-    }
+  if (strcmp(errorMessage, "") && args.Length() != 4)
+  {
+    Napi::Error::New(env, errorMessage).ThrowAsJavaScriptException();
+    return env.Null();
   }
 
+  Napi::Array addresses = patternResults(env, results);
+
   if (args.Length() == 4)
   {
     Napi::Function callback = args[3].As<Napi::Function>();
-    if (!errorMessage.empty())
-      callback.Call(env.Global(), {Napi::String::New(env, errorMessage)});
-    else
-      callback.Call(env.Global(), {Napi::String::New(env, ""), retVal});
+    callback.Call(env.Global(), {Napi::String::New(env, errorMessage), addresses});
     return env.Null();
   }
   else
   {
-    return retVal;
+    return addresses;
   }
 }
 
-Napi::Value readBuffer(const Napi::CallbackInfo &args)
+Napi::Value findPatternAll(const Napi::CallbackInfo &args)
 {
   Napi::Env env = args.Env();
 
-  if (args.Length() != 3 && args.Length() != 4)
+  if (args.Length() < 3 || args.Length() > 5)
   {
-    Napi::Error::New(env, "requires 3 arguments, or 4 arguments if a callback is being used").ThrowAsJavaScriptException();
+    Napi::Error::New(env, "requires 3 or 4 arguments, or 5 arguments if a callback is being used").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  if (!args[0].IsNumber() && !args[1].IsNumber() && !args[2].IsNumber())
+  if (!args[0].IsNumber() || !args[1].IsString() || !args[2].IsString())
   {
-    Napi::Error::New(env, "first, second and third arguments must be a number").ThrowAsJavaScriptException();
+    Napi::Error::New(env, "first argument must be a number, second and third arguments must be strings").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  if (args.Length() == 4 && !args[3].IsFunction())
+  bool hasCallback = args.Length() == 5;
+  if (hasCallback && !args[4].IsFunction())
   {
-    Napi::Error::New(env, "fourth argument must be a function").ThrowAsJavaScriptException();
+    Napi::Error::New(env, "fifth argument must be a function").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
-  uintptr_t address = args[1].As<Napi::Number>().Int64Value();
-  size_t size = args[2].As<Napi::Number>().Int64Value();
-  char *data = Memory.readBuffer(handle, address, size);
-  Napi::Buffer<char> buffer = Napi::Buffer<char>::New(env, data, size);
-  // free(data);
-  //  delete [] data; // deleting the char array...
-  if (args.Length() == 4)
+  // Options: { limit, flags, patternOffset, addressOffset }, all optional
+  size_t limit = 0;
+  short sigType = pattern::ST_NORMAL;
+  uintptr_t patternOffset = 0;
+  uintptr_t addressOffset = 0;
+
+  if (args.Length() >= 4 && args[3].IsObject())
   {
-    Napi::Function callback = args[3].As<Napi::Function>();
-    callback.Call(env.Global(), {Napi::String::New(env, ""), buffer});
+    Napi::Object options = args[3].As<Napi::Object>();
+    Napi::Value value = options.Get("limit");
+    if (value.IsNumber())
+      limit = (size_t)value.As<Napi::Number>().Int64Value();
+
+    value = options.Get("flags");
+    if (value.IsNumber())
+      sigType = value.As<Napi::Number>().Int32Value();
+
+    value = options.Get("patternOffset");
+    if (value.IsNumber())
+      patternOffset = value.As<Napi::Number>().Int32Value();
+
+    value = options.Get("addressOffset");
+    if (value.IsNumber())
+      addressOffset = value.As<Napi::Number>().Int32Value();
+  }
+
+  const char *errorMessage = "";
+  pid_t hProcess = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  std::string moduleName(args[1].As<Napi::String>().Utf8Value());
+  std::string signature(args[2].As<Napi::String>().Utf8Value());
+
+  std::vector<uintptr_t> results;
+  if (!Pattern.findPatternAllInModule(hProcess, moduleName.c_str(), signature.c_str(), sigType, patternOffset, addressOffset, limit, results, &errorMessage) && !strcmp(errorMessage, ""))
+  {
+    errorMessage = "unable to find module";
+  }
+
+  if (strcmp(errorMessage, "") && !hasCallback)
+  {
+    Napi::Error::New(env, errorMessage).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::BigUint64Array addresses = Napi::BigUint64Array::New(env, results.size());
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    addresses[i] = results[i];
+  }
+
+  if (hasCallback)
+  {
+    Napi::Function callback = args[4].As<Napi::Function>();
+    callback.Call(env.Global(), {Napi::String::New(env, errorMessage), addresses});
     return env.Null();
   }
   else
   {
-    return buffer;
+    return addresses;
   }
 }
 
-Napi::Value writeMemory(const Napi::CallbackInfo &args)
+// Reads `{ start, end }` objects, each bound a Number or a BigInt
+bool parseRanges(Napi::Env env, Napi::Value value, std::vector<scanner::range> &ranges)
 {
-  return args.Env().Null();
+  if (!value.IsArray())
+  {
+    Napi::Error::New(env, "regions must be an array of { start, end } objects").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  Napi::Array array = value.As<Napi::Array>();
+  ranges.resize(array.Length());
+
+  for (uint32_t i = 0; i < array.Length(); i++)
+  {
+    Napi::Value entry = array.Get(i);
+    if (!entry.IsObject())
+    {
+      Napi::Error::New(env, "regions must be an array of { start, end } objects").ThrowAsJavaScriptException();
+      return false;
+    }
+
+    Napi::Object range = entry.As<Napi::Object>();
+    uintptr_t start, end;
+    if (!parseAddress(env, range.Get("start"), &start) || !parseAddress(env, range.Get("end"), &end))
+    {
+      return false;
+    }
+
+    ranges[i] = {start, end > start ? end : start};
+  }
+
+  // Scans report addresses in ascending order and once each, so ranges given out of order
+  // or overlapping are sorted and merged, and empty ones dropped
+  std::sort(ranges.begin(), ranges.end(), [](const scanner::range &a, const scanner::range &b) { return a.start < b.start; });
+
+  size_t merged = 0;
+  for (const scanner::range &range : ranges)
+  {
+    if (range.start == range.end)
+      continue;
+
+    if (merged > 0 && range.start <= ranges[merged - 1].end)
+    {
+      if (range.end > ranges[merged - 1].end)
+        ranges[merged - 1].end = range.end;
+      continue;
+    }
+
+    ranges[merged++] = range;
+  }
+  ranges.resize(merged);
+
+  return true;
 }
 
-Napi::Value writeBuffer(const Napi::CallbackInfo &args)
+struct ValueScanRequest
 {
-  return args.Env().Null();
-}
+  pid_t handle;
+  memory::dataType type;
+  valueScanner::target value;
+  // Set when the value is null or undefined, only scan sessions accept that
+  bool unknown;
+  size_t alignment;
+  std::vector<scanner::range> ranges;
+};
 
-Napi::Value virtualProtectEx(const Napi::CallbackInfo &args)
+// Reads the handle, type, value and { regions, alignment } arguments of a value scan. A null or
+// undefined value marks the request as an unknown initial value search. Without
+// `regions` the writable regions of the cached region map are scanned, failing to read the map
+// sets `errorMessage`. Returns false if an exception was thrown for an invalid argument.
+bool parseValueScan(const Napi::CallbackInfo &args, ValueScanRequest *request, const char **errorMessage)
 {
-  return Napi::Number::From(args.Env(), 0);
+  Napi::Env env = args.Env();
+
+  std::string typeName(args[1].As<Napi::String>().Utf8Value());
+  request->handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  request->type = memory::parseDataType(typeName.c_str());
+
+  if (!valueScanner::targetFor(request->type, &request->value))
+  {
+    Napi::Error::New(env, "unsupported data type, expected one of byte, short, int32, uint32, int64, uint64, long, float, double, ptr or bool").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  request->unknown = args[2].IsNull() || args[2].IsUndefined();
+  if (!request->unknown && !encodeValue(env, request->type, args[2], request->value.bytes))
+  {
+    return false;
+  }
+
+  // Values are aligned to their own size by default
+  request->alignment = request->value.size;
+  bool hasRegions = false;
+
+  if (args.Length() >= 4 && args[3].IsObject())
+  {
+    Napi::Object options = args[3].As<Napi::Object>();
+    Napi::Value option = options.Get("alignment");
+    if (option.IsNumber())
+    {
+      int64_t requested = option.As<Napi::Number>().Int64Value();
+      if (requested <= 0 || (requested & (requested - 1)) != 0)
+      {
+        Napi::Error::New(env, "alignment must be a power of two").ThrowAsJavaScriptException();
+        return false;
+      }
+      request->alignment = (size_t)requested;
+    }
+
+    option = options.Get("regions");
+    if (!option.IsUndefined() && !option.IsNull())
+    {
+      if (!parseRanges(env, option, request->ranges))
+      {
+        return false;
+      }
+      hasRegions = true;
+    }
+  }
+
+  if (!hasRegions)
+  {
+    std::shared_ptr<const module::RegionTable> table = module::getRegionMap(request->handle, errorMessage);
+    if (!strcmp(*errorMessage, ""))
+    {
+      request->ranges = valueScanner::writableRanges(*table);
+    }
+  }
+
+  return true;
+}
+
+Napi::Value scanValue(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() < 3 || args.Length() > 5)
+  {
+    Napi::Error::New(env, "requires 3 or 4 arguments, or 5 arguments if a callback is being used").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!args[0].IsNumber() || !args[1].IsString())
+  {
+    Napi::Error::New(env, "first argument must be a number, second argument must be a string").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  bool hasCallback = args.Length() == 5;
+  if (hasCallback && !args[4].IsFunction())
+  {
+    Napi::Error::New(env, "fifth argument must be a function").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  ValueScanRequest request;
+  const char *errorMessage = "";
+  if (!parseValueScan(args, &request, &errorMessage))
+  {
+    return env.Null();
+  }
+
+  if (request.unknown)
+  {
+    Napi::Error::New(env, "third argument must be the value to search for").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::vector<uintptr_t> results;
+  if (!strcmp(errorMessage, ""))
+  {
+    valueScanner::findValue(request.handle, request.value, request.ranges, request.alignment, results);
+  }
+
+  if (strcmp(errorMessage, "") && !hasCallback)
+  {
+    Napi::Error::New(env, errorMessage).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::BigUint64Array addresses = Napi::BigUint64Array::New(env, results.size());
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    addresses[i] = results[i];
+  }
+
+  if (hasCallback)
+  {
+    Napi::Function callback = args[4].As<Napi::Function>();
+    callback.Call(env.Global(), {Napi::String::New(env, errorMessage), addresses});
+    return env.Null();
+  }
+  else
+  {
+    return addresses;
+  }
+}
+
+struct ScanSessionHandle
+{
+  std::unique_ptr<scanSession> instance;
+  // Set on the main thread while nextScanAsync narrows the session on the threadpool
+  bool busy = false;
+};
+
+// Fetches the handle of a session made by createScanSession, throwing and returning NULL if
+// `value` is not one
+ScanSessionHandle *scanSessionFrom(Napi::Env env, Napi::Value value)
+{
+  if (!isTagged(env, value, scanSessionTag))
+  {
+    Napi::Error::New(env, "first argument must be a scan session created by createScanSession").ThrowAsJavaScriptException();
+    return NULL;
+  }
+
+  return value.As<Napi::External<ScanSessionHandle>>().Data();
+}
+
+// Throws unless `value` is an open session made by createScanSession that no asynchronous
+// scan is using
+scanSession *unwrapScanSession(Napi::Env env, Napi::Value value)
+{
+  ScanSessionHandle *sessionHandle = scanSessionFrom(env, value);
+  if (sessionHandle == NULL)
+  {
+    return NULL;
+  }
+
+  if (sessionHandle->busy)
+  {
+    Napi::Error::New(env, "scan session is busy with an asynchronous scan").ThrowAsJavaScriptException();
+    return NULL;
+  }
+
+  scanSession *session = sessionHandle->instance.get();
+  if (session == NULL)
+  {
+    Napi::Error::New(env, "scan session has been closed").ThrowAsJavaScriptException();
+  }
+  return session;
+}
+
+Napi::Value wrapScanSession(Napi::Env env, ScanSessionHandle *sessionHandle)
+{
+  Napi::External<ScanSessionHandle> external = Napi::External<ScanSessionHandle>::New(env, sessionHandle, [](Napi::Env, ScanSessionHandle *sessionHandle) {
+    delete sessionHandle;
+  });
+  return tagExternal(env, external, scanSessionTag);
+}
+
+// Reads the arguments of createScanSession and createScanSessionAsync, throwing and returning
+// false if they are invalid
+bool parseScanSession(const Napi::CallbackInfo &args, ValueScanRequest *request)
+{
+  Napi::Env env = args.Env();
+
+  if (!args[0].IsNumber() || !args[1].IsString())
+  {
+    Napi::Error::New(env, "first argument must be a number, second argument must be a string").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  const char *errorMessage = "";
+  if (!parseValueScan(args, request, &errorMessage))
+  {
+    return false;
+  }
+
+  // Unknown value sessions keep a bitmap of the aligned slots of every block
+  if (request->unknown && request->alignment > scanSession::blockSize)
+  {
+    Napi::Error::New(env, "alignment must be at most 65536 when the initial value is unknown").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  if (strcmp(errorMessage, ""))
+  {
+    Napi::Error::New(env, errorMessage).ThrowAsJavaScriptException();
+    return false;
+  }
+
+  return true;
+}
+
+// Thrown when the candidates of a scan fit neither in memory nor in a temporary file
+const char *scanSpaceError = "out of memory and temporary file space for the scan candidates";
+
+// Runs the first scan of a new session, returning false if it ran out of space
+bool startScanSession(scanSession *session, const ValueScanRequest &request, const std::atomic<bool> *cancelled)
+{
+  if (request.unknown)
+  {
+    return session->snapshotScan(request.ranges, cancelled);
+  }
+
+  return session->firstScan(request.value, request.ranges, cancelled);
+}
+
+Napi::Value createScanSession(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 3 && args.Length() != 4)
+  {
+    Napi::Error::New(env, "requires 3 or 4 arguments, the handle, data type, value and options").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  ValueScanRequest request;
+  if (!parseScanSession(args, &request))
+  {
+    return env.Null();
+  }
+
+  ScanSessionHandle *sessionHandle = new ScanSessionHandle();
+  sessionHandle->instance.reset(new scanSession(request.handle, request.type, request.alignment));
+  if (!startScanSession(sessionHandle->instance.get(), request, NULL))
+  {
+    delete sessionHandle;
+    Napi::Error::New(env, scanSpaceError).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  return wrapScanSession(env, sessionHandle);
+}
+
+// Reads the predicate and the values it compares with from args[1] on. Returns the number
+// of values read, or -1 after throwing if they are invalid.
+int parseNextScan(const Napi::CallbackInfo &args, const scanSession &session, scanSession::predicate *test, unsigned char values[2][8])
+{
+  Napi::Env env = args.Env();
+
+  std::string predicateName(args[1].As<Napi::String>().Utf8Value());
+  if (!scanSession::parsePredicate(predicateName.c_str(), test))
+  {
+    Napi::Error::New(env, "predicate must be one of changed, unchanged, increased, decreased, equal or range").ThrowAsJavaScriptException();
+    return -1;
+  }
+
+  // equal takes one value, range a minimum and a maximum (inclusive)
+  size_t operands = *test == scanSession::P_EQUAL ? 1 : *test == scanSession::P_RANGE ? 2 : 0;
+  if (args.Length() < 2 + operands)
+  {
+    Napi::Error::New(env, operands == 1 ? "equal requires a value" : "range requires a minimum and a maximum").ThrowAsJavaScriptException();
+    return -1;
+  }
+
+  for (size_t i = 0; i < operands; i++)
+  {
+    if (!encodeValue(env, session.type(), args[2 + i], values[i]))
+    {
+      return -1;
+    }
+  }
+
+  return (int)operands;
+}
+
+Napi::Value nextScan(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() < 2 || args.Length() > 4 || !args[1].IsString())
+  {
+    Napi::Error::New(env, "requires a scan session, a predicate and the values the predicate compares with").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  scanSession *session = unwrapScanSession(env, args[0]);
+  if (session == NULL)
+  {
+    return env.Null();
+  }
+
+  scanSession::predicate test;
+  unsigned char values[2][8] = {};
+  int operands = parseNextScan(args, *session, &test, values);
+  if (operands < 0)
+  {
+    return env.Null();
+  }
+
+  if (args.Length() != 2 + (size_t)operands)
+  {
+    Napi::Error::New(env, operands == 0 ? "predicate takes no values" : "too many values for the predicate").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!session->nextScan(test, values[0], values[1]))
+  {
+    Napi::Error::New(env, scanSpaceError).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  return Napi::Value::From(env, (double)session->count());
+}
+
+Napi::Value getScanResults(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() < 1 || args.Length() > 3)
+  {
+    Napi::Error::New(env, "requires a scan session, optionally the index of the first result and a limit").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  scanSession *session = unwrapScanSession(env, args[0]);
+  if (session == NULL)
+  {
+    return env.Null();
+  }
+
+  size_t first = args.Length() >= 2 && args[1].IsNumber() ? (size_t)args[1].As<Napi::Number>().Int64Value() : 0;
+  size_t limit = args.Length() >= 3 && args[2].IsNumber() ? (size_t)args[2].As<Napi::Number>().Int64Value() : session->count();
+
+  std::vector<uintptr_t> found;
+  std::vector<unsigned char> foundValues;
+  session->getResults(first, limit, found, foundValues);
+
+  const size_t size = session->valueSize();
+  Napi::BigUint64Array addresses = Napi::BigUint64Array::New(env, found.size());
+  Napi::Array values = Napi::Array::New(env, found.size());
+  for (size_t i = 0; i < found.size(); i++)
+  {
+    addresses[i] = found[i];
+    values.Set(i, decodeValue(env, session->type(), foundValues.data() + i * size));
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set(Napi::String::New(env, "count"), Napi::Value::From(env, (double)session->count()));
+  result.Set(Napi::String::New(env, "memoryUsage"), Napi::Value::From(env, (double)session->memoryUsage()));
+  result.Set(Napi::String::New(env, "spilledSize"), Napi::Value::From(env, (double)session->spilledSize()));
+  result.Set(Napi::String::New(env, "addresses"), addresses);
+  result.Set(Napi::String::New(env, "values"), values);
+  return result;
+}
+
+// Frees the candidates straight away instead of when the session is garbage collected
+Napi::Value closeScanSession(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 1 || !isTagged(env, args[0], scanSessionTag))
+  {
+    Napi::Error::New(env, "requires 1 argument, a scan session created by createScanSession").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  ScanSessionHandle *sessionHandle = scanSessionFrom(env, args[0]);
+  if (sessionHandle->busy)
+  {
+    Napi::Error::New(env, "scan session is busy with an asynchronous scan").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  sessionHandle->instance.reset();
+  return env.Null();
+}
+
+Napi::Value readMemory(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 3 && args.Length() != 4)
+  {
+    Napi::Error::New(env, "requires 3 arguments, or 4 arguments if a callback is being used").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!args[0].IsNumber() && !args[1].IsNumber() && !args[2].IsString())
+  {
+    Napi::Error::New(env, "first and second argument must be a number, third argument must be a string").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (args.Length() == 4 && !args[3].IsFunction())
+  {
+    Napi::Error::New(env, "fourth argument must be a function").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::string dataTypeArg(args[2].As<Napi::String>().Utf8Value());
+  const char *dataType = dataTypeArg.c_str();
+
+  // Define the error message that will be set if no data type is recognised
+  std::string errorMessage;
+  Napi::Value retVal = env.Null();
+
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  uintptr_t address = args[1].As<Napi::Number>().Int64Value();
+
+  if (!strcmp(dataType, "byte"))
+  {
+
+    unsigned char result = Memory.readMemory<unsigned char>(handle, address);
+    retVal = Napi::Value::From(env, result);
+  }
+  else if (!strcmp(dataType, "int"))
+  {
+
+    int result = Memory.readMemory<int>(handle, address);
+    retVal = Napi::Value::From(env, result);
+  }
+  else if (!strcmp(dataType, "int32"))
+  {
+
+    int32_t result = Memory.readMemory<int32_t>(handle, address);
+    retVal = Napi::Value::From(env, result);
+  }
+  else if (!strcmp(dataType, "uint32"))
+  {
+
+    uint32_t result = Memory.readMemory<uint32_t>(handle, address);
+    retVal = Napi::Value::From(env, result);
+  }
+  else if (!strcmp(dataType, "int64"))
+  {
+
+    int64_t result = Memory.readMemory<int64_t>(handle, address);
+    retVal = Napi::Value::From(env, result);
+  }
+  else if (!strcmp(dataType, "uint64"))
+  {
+
+    uint64_t result = Memory.readMemory<uint64_t>(handle, address);
+    retVal = Napi::Value::From(env, result);
+  }
+  else if (!strcmp(dataType, "dword"))
+  {
+
+    uint32_t result = Memory.readMemory<uint32_t>(handle, address);
+    retVal = Napi::Value::From(env, result);
+  }
+  else if (!strcmp(dataType, "short"))
+  {
+
+    short result = Memory.readMemory<short>(handle, address);
+    retVal = Napi::Value::From(env, result);
+  }
+  else if (!strcmp(dataType, "long"))
+  {
+
+    long result = Memory.readMemory<long>(handle, address);
+    retVal = Napi::Value::From(env, result);
+  }
+  else if (!strcmp(dataType, "float"))
+  {
+
+    float result = Memory.readMemory<float>(handle, address);
+    retVal = Napi::Value::From(env, result);
+  }
+  else if (!strcmp(dataType, "double"))
+  {
+
+    double result = Memory.readMemory<double>(handle, address);
+    retVal = Napi::Value::From(env, result);
+  }
+  else if (!strcmp(dataType, "ptr") || !strcmp(dataType, "pointer"))
+  {
+
+    intptr_t result = Memory.readMemory<intptr_t>(handle, address);
+    retVal = Napi::Value::From(env, result);
+  }
+  else if (!strcmp(dataType, "bool") || !strcmp(dataType, "boolean"))
+  {
+
+    bool result = Memory.readMemory<bool>(handle, address);
+    retVal = Napi::Boolean::New(env, result);
+  }
+  else if (!strcmp(dataType, "string") || !strcmp(dataType, "str"))
+  {
+
+    std::string str;
+
+    // give up at 1 million chars
+    if (!Memory.readString(handle, address, 1000000, &str))
+    {
+
+      if (args.Length() == 4)
+        errorMessage = "unable to read string (no null-terminator found after 1 million chars)";
+      else
+      {
+        Napi::Error::New(env, "unable to read string (no null-terminator found after 1 million chars)").ThrowAsJavaScriptException();
+        return env.Null();
+      }
+    }
+    else
+    {
+      retVal = Napi::String::New(env, str);
+    }
+  }
+  else if (!strcmp(dataType, "vector3") || !strcmp(dataType, "vec3"))
+  {
+
+    Vector3 result = Memory.readMemory<Vector3>(handle, address);
+    Napi::Object moduleInfo = Napi::Object::New(env);
+    moduleInfo.Set(Napi::String::New(env, "x"), Napi::Value::From(env, result.x));
+    moduleInfo.Set(Napi::String::New(env, "y"), Napi::Value::From(env, result.y));
+    moduleInfo.Set(Napi::String::New(env, "z"), Napi::Value::From(env, result.z));
+
+    retVal = moduleInfo;
+  }
+  else if (!strcmp(dataType, "vector4") || !strcmp(dataType, "vec4"))
+  {
+
+    Vector4 result = Memory.readMemory<Vector4>(handle, address);
+    Napi::Object moduleInfo = Napi::Object::New(env);
+    moduleInfo.Set(Napi::String::New(env, "w"), Napi::Value::From(env, result.w));
+    moduleInfo.Set(Napi::String::New(env, "x"), Napi::Value::From(env, result.x));
+    moduleInfo.Set(Napi::String::New(env, "y"), Napi::Value::From(env, result.y));
+    moduleInfo.Set(Napi::String::New(env, "z"), Napi::Value::From(env, result.z));
+
+    retVal = moduleInfo;
+  }
+  else
+  {
+
+    if (args.Length() == 4)
+      errorMessage = "unexpected data type";
+    else
+    {
+      Napi::Error::New(env, "unexpected data type").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+  }
+
+  if (args.Length() == 4)
+  {
+    Napi::Function callback = args[3].As<Napi::Function>();
+    if (!errorMessage.empty())
+      callback.Call(env.Global(), {Napi::String::New(env, errorMessage)});
+    else
+      callback.Call(env.Global(), {Napi::String::New(env, ""), retVal});
+    return env.Null();
+  }
+  else
+  {
+    return retVal;
+  }
+}
+
+Napi::Value readString(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 3 && args.Length() != 4)
+  {
+    Napi::Error::New(env, "requires 3 arguments, or 4 arguments if a callback is being used").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!args[0].IsNumber() || !args[1].IsNumber() || !args[2].IsNumber())
+  {
+    Napi::Error::New(env, "first, second and third arguments must be a number").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (args.Length() == 4 && !args[3].IsFunction())
+  {
+    Napi::Error::New(env, "fourth argument must be a function").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  uintptr_t address = args[1].As<Napi::Number>().Int64Value();
+  size_t maxLength = args[2].As<Napi::Number>().Int64Value();
+
+  // Strings longer than maxLength are truncated rather than treated as an error
+  std::string str;
+  Memory.readString(handle, address, maxLength, &str);
+  Napi::String result = Napi::String::New(env, str);
+
+  if (args.Length() == 4)
+  {
+    Napi::Function callback = args[3].As<Napi::Function>();
+    callback.Call(env.Global(), {Napi::String::New(env, ""), result});
+    return env.Null();
+  }
+  else
+  {
+    return result;
+  }
+}
+
+Napi::Value readMemoryBatch(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 2 && args.Length() != 3)
+  {
+    Napi::Error::New(env, "requires 2 arguments, or 3 arguments if a callback is being used").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!args[0].IsNumber() || !args[1].IsArray())
+  {
+    Napi::Error::New(env, "first argument must be a number, second argument must be an array").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (args.Length() == 3 && !args[2].IsFunction())
+  {
+    Napi::Error::New(env, "third argument must be a function").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  Napi::Array requests = args[1].As<Napi::Array>();
+  uint32_t count = requests.Length();
+
+  // Resolve every request up front so all of the reads land in one contiguous buffer
+  std::vector<memory::dataType> types(count);
+  std::vector<memory::batchEntry> entries(count);
+  std::vector<size_t> offsets(count);
+  size_t totalSize = 0;
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    Napi::Value request = requests.Get(i);
+    if (!request.IsObject())
+    {
+      Napi::Error::New(env, "every batch entry must be an object of the form { address, type }").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    Napi::Object entry = request.As<Napi::Object>();
+    Napi::Value address = entry.Get("address");
+    Napi::Value type = entry.Get("type");
+    if (!address.IsNumber() || !type.IsString())
+    {
+      Napi::Error::New(env, "every batch entry must be an object of the form { address, type }").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    std::string typeName(type.As<Napi::String>().Utf8Value());
+    types[i] = memory::parseDataType(typeName.c_str());
+    if (types[i] == memory::T_UNKNOWN)
+    {
+      Napi::Error::New(env, "unexpected data type").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    entries[i].address = address.As<Napi::Number>().Int64Value();
+    entries[i].size = memory::dataTypeSize(types[i]);
+    offsets[i] = totalSize;
+    totalSize += entries[i].size;
+  }
+
+  std::vector<unsigned char> data(totalSize);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    entries[i].buffer = data.data() + offsets[i];
+  }
+
+  Memory.readMemoryBatch(handle, entries.data(), entries.size());
+
+  // Entries that could not be read are reported as null rather than zero
+  Napi::Array results = Napi::Array::New(env, count);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    results.Set(i, entries[i].ok ? decodeValue(env, types[i], entries[i].buffer) : env.Null());
+  }
+
+  if (args.Length() == 3)
+  {
+    Napi::Function callback = args[2].As<Napi::Function>();
+    callback.Call(env.Global(), {Napi::String::New(env, ""), results});
+    return env.Null();
+  }
+  else
+  {
+    return results;
+  }
+}
+
+// Storage behind a memory::pointerChain parsed from JS arguments
+struct PointerChainRequest
+{
+  std::vector<int64_t> offsets;
+  memory::dataType type;
+  uintptr_t base;
+  size_t valueOffset;
+};
+
+// Parses (base, offsets, type) into `request`, throwing and returning false if they are invalid
+bool parsePointerChain(Napi::Env env, Napi::Value base, Napi::Value offsets, Napi::Value type, PointerChainRequest &request)
+{
+  if (!base.IsNumber() || !offsets.IsArray() || !type.IsString())
+  {
+    Napi::Error::New(env, "a pointer chain needs a numeric base, an array of offsets and a data type").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  std::string typeName(type.As<Napi::String>().Utf8Value());
+  request.type = memory::parseDataType(typeName.c_str());
+  if (request.type == memory::T_UNKNOWN)
+  {
+    Napi::Error::New(env, "unexpected data type").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  Napi::Array offsetArray = offsets.As<Napi::Array>();
+  request.offsets.resize(offsetArray.Length());
+  for (uint32_t i = 0; i < offsetArray.Length(); i++)
+  {
+    Napi::Value offset = offsetArray.Get(i);
+    if (!offset.IsNumber())
+    {
+      Napi::Error::New(env, "pointer chain offsets must be numbers").ThrowAsJavaScriptException();
+      return false;
+    }
+    request.offsets[i] = offset.As<Napi::Number>().Int64Value();
+  }
+
+  request.base = base.As<Napi::Number>().Int64Value();
+  return true;
+}
+
+// Reads the pointer size argument at `index`, defaulting to the native pointer size
+bool parsePointerSize(const Napi::CallbackInfo &args, size_t index, size_t &pointerSize)
+{
+  pointerSize = sizeof(uintptr_t);
+  if (args.Length() <= index || args[index].IsUndefined())
+  {
+    return true;
+  }
+
+  if (args[index].IsNumber())
+  {
+    pointerSize = args[index].As<Napi::Number>().Uint32Value();
+  }
+
+  if (!args[index].IsNumber() || (pointerSize != 4 && pointerSize != 8))
+  {
+    Napi::Error::New(args.Env(), "pointer size must be 4 or 8").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  return true;
+}
+
+Napi::Object pointerChainResult(Napi::Env env, const memory::pointerChain &chain, memory::dataType type)
+{
+  Napi::Object result = Napi::Object::New(env);
+  bool resolved = chain.failedLevel < 0;
+  result.Set(Napi::String::New(env, "value"), resolved ? decodeValue(env, type, chain.result) : env.Null());
+  result.Set(Napi::String::New(env, "address"), resolved ? Napi::Value::From(env, chain.address) : env.Null());
+  result.Set(Napi::String::New(env, "failedLevel"), Napi::Value::From(env, chain.failedLevel));
+  return result;
+}
+
+Napi::Value readPointerChain(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 4 && args.Length() != 5)
+  {
+    Napi::Error::New(env, "requires 4 arguments, or 5 arguments if a pointer size is given").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!args[0].IsNumber())
+  {
+    Napi::Error::New(env, "first argument must be a number").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  PointerChainRequest request;
+  size_t pointerSize;
+  if (!parsePointerChain(env, args[1], args[2], args[3], request) || !parsePointerSize(args, 4, pointerSize))
+  {
+    return env.Null();
+  }
+
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  unsigned char value[sizeof(Vector4)] = {0};
+  memory::pointerChain chain = {request.base, request.offsets.data(), request.offsets.size(), value, memory::dataTypeSize(request.type), 0, -1};
+
+  Memory.readPointerChains(handle, &chain, 1, pointerSize);
+  return pointerChainResult(env, chain, request.type);
+}
+
+Napi::Value readPointerChains(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 2 && args.Length() != 3)
+  {
+    Napi::Error::New(env, "requires 2 arguments, or 3 arguments if a pointer size is given").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!args[0].IsNumber() || !args[1].IsArray())
+  {
+    Napi::Error::New(env, "first argument must be a number, second argument must be an array").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  size_t pointerSize;
+  if (!parsePointerSize(args, 2, pointerSize))
+  {
+    return env.Null();
+  }
+
+  Napi::Array chainArray = args[1].As<Napi::Array>();
+  uint32_t count = chainArray.Length();
+  std::vector<PointerChainRequest> requests(count);
+  size_t valueSize = 0;
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    Napi::Value entry = chainArray.Get(i);
+    if (!entry.IsObject())
+    {
+      Napi::Error::New(env, "every pointer chain must be an object of the form { base, offsets, type }").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    Napi::Object chain = entry.As<Napi::Object>();
+    if (!parsePointerChain(env, chain.Get("base"), chain.Get("offsets"), chain.Get("type"), requests[i]))
+    {
+      return env.Null();
+    }
+
+    requests[i].valueOffset = valueSize;
+    valueSize += memory::dataTypeSize(requests[i].type);
+  }
+
+  std::vector<unsigned char> values(valueSize);
+  std::vector<memory::pointerChain> chains(count);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    PointerChainRequest &request = requests[i];
+    chains[i] = {request.base, request.offsets.data(), request.offsets.size(), values.data() + request.valueOffset, memory::dataTypeSize(request.type), 0, -1};
+  }
+
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  Memory.readPointerChains(handle, chains.data(), chains.size(), pointerSize);
+
+  Napi::Array results = Napi::Array::New(env, count);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    results.Set(i, pointerChainResult(env, chains[i], requests[i].type));
+  }
+
+  return results;
+}
+
+struct PointerMapHandle
+{
+  std::unique_ptr<pointerScanner::pointerMap> instance;
+  // findPointerPathsAsync searches running on the threadpool, which only read the map
+  size_t searches = 0;
+};
+
+Napi::Value wrapPointerMap(Napi::Env env, pointerScanner::pointerMap *map)
+{
+  PointerMapHandle *mapHandle = new PointerMapHandle();
+  mapHandle->instance.reset(map);
+
+  Napi::External<PointerMapHandle> external = Napi::External<PointerMapHandle>::New(env, mapHandle, [](Napi::Env, PointerMapHandle *mapHandle) {
+    delete mapHandle;
+  });
+  return tagExternal(env, external, pointerMapTag);
+}
+
+// Throws unless `value` is an open pointer map made by createPointerMap or loadPointerMap
+pointerScanner::pointerMap *unwrapPointerMap(Napi::Env env, Napi::Value value)
+{
+  if (!isTagged(env, value, pointerMapTag))
+  {
+    Napi::Error::New(env, "first argument must be a pointer map created by createPointerMap or loadPointerMap").ThrowAsJavaScriptException();
+    return NULL;
+  }
+
+  pointerScanner::pointerMap *map = value.As<Napi::External<PointerMapHandle>>().Data()->instance.get();
+  if (map == NULL)
+  {
+    Napi::Error::New(env, "pointer map has been closed").ThrowAsJavaScriptException();
+  }
+  return map;
+}
+
+Napi::Value createPointerMap(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 1 && args.Length() != 2)
+  {
+    Napi::Error::New(env, "requires 1 argument, or 2 arguments if a pointer size is given").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!args[0].IsNumber())
+  {
+    Napi::Error::New(env, "first argument must be a number").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  size_t pointerSize;
+  if (!parsePointerSize(args, 1, pointerSize))
+  {
+    return env.Null();
+  }
+
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  std::unique_ptr<pointerScanner::pointerMap> map(new pointerScanner::pointerMap());
+  const char *errorMessage = "";
+
+  if (!pointerScanner::buildMap(handle, pointerSize, map.get(), &errorMessage))
+  {
+    Napi::Error::New(env, errorMessage).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  return wrapPointerMap(env, map.release());
+}
+
+// Reads the address and the { maxDepth, maxOffset, maxResults } options of findPointerPaths
+// and findPointerPathsAsync, throwing and returning false if they are invalid
+bool parsePointerSearch(const Napi::CallbackInfo &args, uintptr_t *address, pointerScanner::searchOptions *result)
+{
+  Napi::Env env = args.Env();
+
+  if (!parseAddress(env, args[1], address))
+  {
+    return false;
+  }
+
+  pointerScanner::searchOptions options = {4, 4096, 10000};
+  if (args.Length() >= 3 && args[2].IsObject())
+  {
+    Napi::Object optionObject = args[2].As<Napi::Object>();
+    const char *keys[] = { "maxDepth", "maxOffset", "maxResults" };
+    uint64_t values[] = { options.maxDepth, options.maxOffset, options.maxResults };
+
+    for (size_t i = 0; i < 3; i++)
+    {
+      Napi::Value value = optionObject.Get(keys[i]);
+      if (value.IsUndefined()) continue;
+
+      if (!value.IsNumber() || value.As<Napi::Number>().DoubleValue() < 0)
+      {
+        Napi::Error::New(env, std::string(keys[i]) + " must be a positive number").ThrowAsJavaScriptException();
+        return false;
+      }
+      values[i] = (uint64_t)value.As<Napi::Number>().Int64Value();
+    }
+
+    options = {(size_t)values[0], values[1], (size_t)values[2]};
+  }
+
+  if (options.maxDepth > pointerScanner::maxSearchDepth)
+  {
+    Napi::Error::New(env, "maxDepth must be at most " + std::to_string(pointerScanner::maxSearchDepth)).ThrowAsJavaScriptException();
+    return false;
+  }
+
+  *result = options;
+  return true;
+}
+
+Napi::Array pointerPathsResult(Napi::Env env, const pointerScanner::pointerMap *map, const std::vector<pointerScanner::path> &paths)
+{
+  Napi::Array results = Napi::Array::New(env, paths.size());
+  for (size_t i = 0; i < paths.size(); i++)
+  {
+    Napi::Array offsets = Napi::Array::New(env, paths[i].offsets.size());
+    for (size_t j = 0; j < paths[i].offsets.size(); j++)
+    {
+      offsets.Set(j, Napi::Value::From(env, (double)paths[i].offsets[j]));
+    }
+
+    Napi::Object path = Napi::Object::New(env);
+    path.Set(Napi::String::New(env, "module"), Napi::String::New(env, map->modules[paths[i].module]));
+    path.Set(Napi::String::New(env, "base"), Napi::Value::From(env, (double)map->moduleBases[paths[i].module]));
+    path.Set(Napi::String::New(env, "offsets"), offsets);
+    results.Set(i, path);
+  }
+
+  return results;
+}
+
+Napi::Value findPointerPaths(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 2 && args.Length() != 3)
+  {
+    Napi::Error::New(env, "requires a pointer map, an address and optionally { maxDepth, maxOffset, maxResults }").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  pointerScanner::pointerMap *map = unwrapPointerMap(env, args[0]);
+  if (map == NULL)
+  {
+    return env.Null();
+  }
+
+  uintptr_t address;
+  pointerScanner::searchOptions options;
+  if (!parsePointerSearch(args, &address, &options))
+  {
+    return env.Null();
+  }
+
+  std::vector<pointerScanner::path> paths;
+  pointerScanner::findPaths(*map, address, options, paths);
+  return pointerPathsResult(env, map, paths);
+}
+
+Napi::Value savePointerMap(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 2 || !args[1].IsString())
+  {
+    Napi::Error::New(env, "requires 2 arguments, a pointer map and a file path").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  pointerScanner::pointerMap *map = unwrapPointerMap(env, args[0]);
+  if (map == NULL)
+  {
+    return env.Null();
+  }
+
+  const char *errorMessage = "";
+  std::string path(args[1].As<Napi::String>().Utf8Value());
+  if (!pointerScanner::save(*map, path.c_str(), &errorMessage))
+  {
+    Napi::Error::New(env, errorMessage).ThrowAsJavaScriptException();
+  }
+
+  return env.Null();
+}
+
+Napi::Value loadPointerMap(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 1 || !args[0].IsString())
+  {
+    Napi::Error::New(env, "requires 1 argument, the path of a saved pointer map").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  const char *errorMessage = "";
+  std::string path(args[0].As<Napi::String>().Utf8Value());
+  std::unique_ptr<pointerScanner::pointerMap> map(new pointerScanner::pointerMap());
+
+  if (!pointerScanner::load(path.c_str(), map.get(), &errorMessage))
+  {
+    Napi::Error::New(env, errorMessage).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  return wrapPointerMap(env, map.release());
+}
+
+// Frees the map straight away instead of when it is garbage collected
+Napi::Value closePointerMap(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 1 || !isTagged(env, args[0], pointerMapTag))
+  {
+    Napi::Error::New(env, "requires 1 argument, a pointer map created by createPointerMap or loadPointerMap").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  PointerMapHandle *mapHandle = args[0].As<Napi::External<PointerMapHandle>>().Data();
+  if (mapHandle->searches != 0)
+  {
+    Napi::Error::New(env, "pointer map is in use by an asynchronous search").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  mapHandle->instance.reset();
+  return env.Null();
+}
+
+// Bounds on structs and struct arrays, so a bad offset, stride or count cannot ask for
+// unbounded memory. Every field of a struct ends within maxStructStride bytes.
+const size_t maxStructStride = 16 * 1024 * 1024;
+const size_t maxStructArrayRead = 256 * 1024 * 1024;
+
+Napi::Value defineStruct(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 1 || !args[0].IsObject())
+  {
+    Napi::Error::New(env, "requires 1 argument, an object of the form { name: [type, offset] }").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Object fields = args[0].As<Napi::Object>();
+  Napi::Array names = fields.GetPropertyNames().As<Napi::Array>();
+
+  memory::structLayout *layout = new memory::structLayout();
+  layout->size = 0;
+
+  for (uint32_t i = 0; i < names.Length(); i++)
+  {
+    std::string name(names.Get(i).As<Napi::String>().Utf8Value());
+    Napi::Value field = fields.Get(name);
+
+    if (!field.IsArray() || field.As<Napi::Array>().Length() != 2 || !field.As<Napi::Array>().Get((uint32_t)0).IsString() || !field.As<Napi::Array>().Get((uint32_t)1).IsNumber())
+    {
+      delete layout;
+      Napi::Error::New(env, "every struct field must be of the form [type, offset]").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    Napi::Array definition = field.As<Napi::Array>();
+    std::string typeName(definition.Get((uint32_t)0).As<Napi::String>().Utf8Value());
+    memory::dataType type = memory::parseDataType(typeName.c_str());
+    int64_t offset = definition.Get((uint32_t)1).As<Napi::Number>().Int64Value();
+
+    if (type == memory::T_UNKNOWN || offset < 0)
+    {
+      delete layout;
+      Napi::Error::New(env, type == memory::T_UNKNOWN ? "unexpected data type" : "struct field offsets must not be negative").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    if ((uint64_t)offset > maxStructStride - memory::dataTypeSize(type))
+    {
+      delete layout;
+      Napi::Error::New(env, "struct fields must end within 16MB of the start of the struct").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    layout->fields.push_back({name, type, (size_t)offset});
+    if ((size_t)offset + memory::dataTypeSize(type) > layout->size)
+    {
+      layout->size = (size_t)offset + memory::dataTypeSize(type);
+    }
+  }
+
+  return tagExternal(env, Napi::External<memory::structLayout>::New(env, layout, [](Napi::Env, memory::structLayout *layout) { delete layout; }), structLayoutTag);
+}
+
+// Fetches the layout created by defineStruct, throwing and returning NULL if `value` is not one
+memory::structLayout *structLayoutFrom(Napi::Env env, Napi::Value value)
+{
+  if (!isTagged(env, value, structLayoutTag))
+  {
+    Napi::Error::New(env, "expected a struct layout created by defineStruct").ThrowAsJavaScriptException();
+    return NULL;
+  }
+
+  return value.As<Napi::External<memory::structLayout>>().Data();
+}
+
+Napi::Object decodeStruct(Napi::Env env, const memory::structLayout &layout, const unsigned char *data)
+{
+  Napi::Object result = Napi::Object::New(env);
+  for (const memory::structLayout::field &field : layout.fields)
+  {
+    result.Set(field.name, decodeValue(env, field.type, data + field.offset));
+  }
+  return result;
+}
+
+Napi::Value readStruct(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 3)
+  {
+    Napi::Error::New(env, "requires 3 arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!args[0].IsNumber() || !args[1].IsNumber())
+  {
+    Napi::Error::New(env, "first and second argument must be a number").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  memory::structLayout *layout = structLayoutFrom(env, args[2]);
+  if (layout == NULL)
+  {
+    return env.Null();
+  }
+
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  uintptr_t address = args[1].As<Napi::Number>().Int64Value();
+
+  std::vector<unsigned char> data(layout->size);
+  Memory.readMemoryData(handle, address, data.data(), data.size());
+
+  return decodeStruct(env, *layout, data.data());
+}
+
+Napi::Value readStructArray(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 4 && args.Length() != 5)
+  {
+    Napi::Error::New(env, "requires 4 arguments, or 5 arguments if a stride is given").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!args[0].IsNumber() || !args[1].IsNumber() || !args[3].IsNumber() || (args.Length() == 5 && !args[4].IsNumber()))
+  {
+    Napi::Error::New(env, "handle, address, count and stride must be numbers").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  memory::structLayout *layout = structLayoutFrom(env, args[2]);
+  if (layout == NULL)
+  {
+    return env.Null();
+  }
+
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  uintptr_t address = args[1].As<Napi::Number>().Int64Value();
+  uint32_t count = args[3].As<Napi::Number>().Uint32Value();
+  int64_t stride = args.Length() == 5 ? args[4].As<Napi::Number>().Int64Value() : (int64_t)layout->size;
+
+  if (stride < (int64_t)layout->size || stride > (int64_t)maxStructStride)
+  {
+    Napi::Error::New(env, "stride must be at least the size of the struct and at most 16MB").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  // The whole array is fetched with a single read
+  size_t span = 0;
+  if (count != 0 && (__builtin_mul_overflow((size_t)stride, (size_t)(count - 1), &span) || __builtin_add_overflow(span, layout->size, &span) || span > maxStructArrayRead))
+  {
+    Napi::Error::New(env, "struct array spans more than 256MB").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::vector<unsigned char> data(span);
+  std::vector<uint8_t> validPages;
+  Memory.readMemoryPartial(handle, address, data.data(), data.size(), &validPages);
+
+  const size_t page = memory::pageSize();
+  const uintptr_t firstPage = address & ~(uintptr_t)(page - 1);
+
+  // Structs touching a page that could not be read come back as null
+  Napi::Array results = Napi::Array::New(env, count);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    const size_t offset = (size_t)stride * i;
+    bool readable = true;
+    for (size_t index = (address + offset - firstPage) / page; readable && layout->size != 0 && index <= (address + offset + layout->size - 1 - firstPage) / page; index++)
+    {
+      readable = (validPages[index / 8] >> (index % 8)) & 1;
+    }
+
+    results.Set(i, readable ? (Napi::Value)decodeStruct(env, *layout, data.data() + offset) : env.Null());
+  }
+
+  return results;
+}
+
+Napi::Value readBuffer(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 3 && args.Length() != 4)
+  {
+    Napi::Error::New(env, "requires 3 arguments, or 4 arguments if a callback is being used").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!args[0].IsNumber() && !args[1].IsNumber() && !args[2].IsNumber())
+  {
+    Napi::Error::New(env, "first, second and third arguments must be a number").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (args.Length() == 4 && !args[3].IsFunction())
+  {
+    Napi::Error::New(env, "fourth argument must be a function").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  uintptr_t address = args[1].As<Napi::Number>().Int64Value();
+  size_t size = args[2].As<Napi::Number>().Int64Value();
+
+  // Read straight into a node-owned buffer so nothing needs to be freed afterwards
+  Napi::Buffer<char> buffer = Napi::Buffer<char>::New(env, size);
+  Memory.readMemoryData(handle, address, buffer.Data(), size);
+  if (args.Length() == 4)
+  {
+    Napi::Function callback = args[3].As<Napi::Function>();
+    callback.Call(env.Global(), {Napi::String::New(env, ""), buffer});
+    return env.Null();
+  }
+  else
+  {
+    return buffer;
+  }
+}
+
+Napi::Value readBufferInto(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() < 3 || args.Length() > 5)
+  {
+    Napi::Error::New(env, "requires 3 arguments, or up to 5 arguments if an offset and length are given").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!args[0].IsNumber() || !args[1].IsNumber())
+  {
+    Napi::Error::New(env, "first and second argument must be a number").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  // Resolve the backing store of whatever view or buffer was passed in
+  uint8_t *target = NULL;
+  size_t targetLength = 0;
+
+  if (args[2].IsTypedArray())
+  {
+    Napi::TypedArray array = args[2].As<Napi::TypedArray>();
+    target = (uint8_t *)array.ArrayBuffer().Data() + array.ByteOffset();
+    targetLength = array.ByteLength();
+  }
+  else if (args[2].IsDataView())
+  {
+    Napi::DataView view = args[2].As<Napi::DataView>();
+    target = (uint8_t *)view.ArrayBuffer().Data() + view.ByteOffset();
+    targetLength = view.ByteLength();
+  }
+  else if (args[2].IsArrayBuffer())
+  {
+    Napi::ArrayBuffer arrayBuffer = args[2].As<Napi::ArrayBuffer>();
+    target = (uint8_t *)arrayBuffer.Data();
+    targetLength = arrayBuffer.ByteLength();
+  }
+  else
+  {
+    Napi::Error::New(env, "third argument must be a Buffer, TypedArray, DataView or ArrayBuffer").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if ((args.Length() > 3 && !args[3].IsNumber()) || (args.Length() > 4 && !args[4].IsNumber()))
+  {
+    Napi::Error::New(env, "offset and length must be numbers").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  int64_t offset = args.Length() > 3 ? args[3].As<Napi::Number>().Int64Value() : 0;
+  int64_t length = args.Length() > 4 ? args[4].As<Napi::Number>().Int64Value() : (int64_t)targetLength - offset;
+
+  if (offset < 0 || length < 0 || (uint64_t)(offset + length) > targetLength)
+  {
+    Napi::Error::New(env, "offset and length must lie within the target buffer").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  uintptr_t address = args[1].As<Napi::Number>().Int64Value();
+
+  size_t bytesRead = Memory.readMemoryPartial(handle, address, target + offset, length, NULL);
+  return Napi::Value::From(env, bytesRead);
+}
+
+Napi::Value readBufferPartial(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 3 && args.Length() != 4)
+  {
+    Napi::Error::New(env, "requires 3 arguments, or 4 arguments if a callback is being used").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!args[0].IsNumber() || !args[1].IsNumber() || !args[2].IsNumber())
+  {
+    Napi::Error::New(env, "first, second and third arguments must be a number").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (args.Length() == 4 && !args[3].IsFunction())
+  {
+    Napi::Error::New(env, "fourth argument must be a function").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  uintptr_t address = args[1].As<Napi::Number>().Int64Value();
+  size_t size = args[2].As<Napi::Number>().Int64Value();
+
+  // Read straight into a node-owned buffer, unreadable pages are left zeroed
+  Napi::Buffer<char> buffer = Napi::Buffer<char>::New(env, size);
+  std::vector<uint8_t> validPages;
+  size_t bytesRead = Memory.readMemoryPartial(handle, address, buffer.Data(), size, &validPages);
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set(Napi::String::New(env, "buffer"), buffer);
+  result.Set(Napi::String::New(env, "bytesRead"), Napi::Value::From(env, bytesRead));
+  result.Set(Napi::String::New(env, "validPages"), Napi::Buffer<uint8_t>::Copy(env, validPages.data(), validPages.size()));
+  result.Set(Napi::String::New(env, "pageSize"), Napi::Value::From(env, memory::pageSize()));
+
+  if (args.Length() == 4)
+  {
+    Napi::Function callback = args[3].As<Napi::Function>();
+    callback.Call(env.Global(), {Napi::String::New(env, ""), result});
+    return env.Null();
+  }
+  else
+  {
+    return result;
+  }
+}
+
+Napi::Value writeMemory(const Napi::CallbackInfo &args)
+{
+  return args.Env().Null();
+}
+
+Napi::Value writeBuffer(const Napi::CallbackInfo &args)
+{
+  return args.Env().Null();
+}
+
+Napi::Value virtualProtectEx(const Napi::CallbackInfo &args)
+{
+  return Napi::Number::From(args.Env(), 0);
+}
+
+// Shared flag behind the tokens handed to the promise-based functions; raising it
+// makes any worker holding the token give up and reject.
+struct CancelToken
+{
+  std::shared_ptr<std::atomic<bool>> cancelled;
+};
+
+Napi::Value createCancelToken(const Napi::CallbackInfo &args)
+{
+  CancelToken *token = new CancelToken{std::make_shared<std::atomic<bool>>(false)};
+  return tagExternal(args.Env(), Napi::External<CancelToken>::New(args.Env(), token, [](Napi::Env, CancelToken *token) { delete token; }), cancelTokenTag);
+}
+
+Napi::Value cancel(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 1 || !isTagged(env, args[0], cancelTokenTag))
+  {
+    Napi::Error::New(env, "requires 1 argument, a token created by createCancelToken").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  args[0].As<Napi::External<CancelToken>>().Data()->cancelled->store(true);
+  return env.Null();
+}
+
+// Runs Execute on the libuv threadpool and settles a promise with the result built by
+// Resolve on the main thread. Workers given a cancel token reject once it is raised.
+class PromiseWorker : public Napi::AsyncWorker
+{
+public:
+  PromiseWorker(Napi::Env env, Napi::Value token)
+      : Napi::AsyncWorker(env), deferred(Napi::Promise::Deferred::New(env))
+  {
+    if (isTagged(env, token, cancelTokenTag))
+    {
+      cancelled = token.As<Napi::External<CancelToken>>().Data()->cancelled;
+    }
+  }
+
+  Napi::Promise Promise() { return deferred.Promise(); }
+
+protected:
+  virtual void Run() = 0;
+  virtual Napi::Value Resolve(Napi::Env env) = 0;
+
+  bool Cancelled() { return cancelled && cancelled->load(); }
+  const std::atomic<bool> *CancelFlag() { return cancelled.get(); }
+
+  void Execute() override
+  {
+    if (!Cancelled())
+    {
+      Run();
+    }
+
+    if (Cancelled())
+    {
+      SetError("operation was aborted");
+    }
+  }
+
+  void OnOK() override { deferred.Resolve(Resolve(Env())); }
+  void OnError(const Napi::Error &error) override { deferred.Reject(error.Value()); }
+
+private:
+  Napi::Promise::Deferred deferred;
+  std::shared_ptr<std::atomic<bool>> cancelled;
+};
+
+// Queues `worker` and returns its promise
+Napi::Value queuePromiseWorker(PromiseWorker *worker)
+{
+  Napi::Promise promise = worker->Promise();
+  worker->Queue();
+  return promise;
+}
+
+class GetProcessesWorker : public PromiseWorker
+{
+public:
+  GetProcessesWorker(Napi::Env env, Napi::Value token) : PromiseWorker(env, token) {}
+
+protected:
+  void Run() override
+  {
+    const char *errorMessage = "";
+    processStats = Process.getProcesses(&errorMessage);
+    if (strcmp(errorMessage, ""))
+      SetError(errorMessage);
+  }
+
+  Napi::Value Resolve(Napi::Env env) override
+  {
+    Napi::Array processes = Napi::Array::New(env, processStats.size());
+    for (std::vector<pid_t>::size_type i = 0; i != processStats.size(); i++)
+    {
+      Napi::Object process = Napi::Object::New(env);
+      process.Set(Napi::String::New(env, "szExeFile"), Napi::String::From(env, processStats[i].comm));
+      process.Set(Napi::String::New(env, "th32ProcessID"), Napi::Value::From(env, processStats[i].pid));
+      processes.Set(i, process);
+    }
+    return processes;
+  }
+
+private:
+  std::vector<process::processStat> processStats;
+};
+
+class FindModuleWorker : public PromiseWorker
+{
+public:
+  FindModuleWorker(Napi::Env env, Napi::Value token, std::string moduleName, pid_t processId)
+      : PromiseWorker(env, token), moduleName(moduleName), processId(processId) {}
+
+protected:
+  void Run() override
+  {
+    const char *errorMessage = "";
+    module = module::findModule(moduleName.c_str(), processId, &errorMessage);
+    if (strcmp(errorMessage, ""))
+      SetError(errorMessage);
+  }
+
+  Napi::Value Resolve(Napi::Env env) override
+  {
+    Napi::Object moduleInfo = Napi::Object::New(env);
+    moduleInfo.Set(Napi::String::New(env, "modBaseAddr"), Napi::Value::From(env, module.start));
+    moduleInfo.Set(Napi::String::New(env, "szExePath"), Napi::Value::From(env, module.pathname));
+    return moduleInfo;
+  }
+
+private:
+  std::string moduleName;
+  pid_t processId;
+  module::Module module;
+};
+
+class ReadMemoryWorker : public PromiseWorker
+{
+public:
+  ReadMemoryWorker(Napi::Env env, Napi::Value token, pid_t handle, uintptr_t address, memory::dataType type, bool isString)
+      : PromiseWorker(env, token), handle(handle), address(address), type(type), isString(isString) {}
+
+protected:
+  void Run() override
+  {
+    if (isString)
+    {
+      if (!Memory.readString(handle, address, 1000000, &str))
+        SetError("unable to read string (no null-terminator found after 1 million chars)");
+      return;
+    }
+
+    Memory.readMemoryData(handle, address, value, memory::dataTypeSize(type));
+  }
+
+  Napi::Value Resolve(Napi::Env env) override
+  {
+    if (isString)
+      return Napi::String::New(env, str);
+    return decodeValue(env, type, value);
+  }
+
+private:
+  pid_t handle;
+  uintptr_t address;
+  memory::dataType type;
+  bool isString;
+  unsigned char value[sizeof(Vector4)];
+  std::string str;
+};
+
+// Largest buffer readBufferAsync reads
+const size_t maxAsyncBufferSize = 1024 * 1024 * 1024;
+
+class ReadBufferWorker : public PromiseWorker
+{
+public:
+  ReadBufferWorker(Napi::Env env, Napi::Value token, pid_t handle, uintptr_t address, size_t size)
+      : PromiseWorker(env, token), handle(handle), address(address), size(size), data(NULL) {}
+
+  ~ReadBufferWorker() { delete[] data; }
+
+protected:
+  void Run() override
+  {
+    // Zeroed, so nothing left over on the heap can end up in the result
+    data = new (std::nothrow) char[size]();
+    if (data == NULL)
+    {
+      SetError("out of memory");
+      return;
+    }
+
+    Memory.readMemoryData(handle, address, data, size);
+  }
+
+  Napi::Value Resolve(Napi::Env env) override
+  {
+    // Hand the allocation over to the Buffer, which frees it once collected
+    char *result = data;
+    data = NULL;
+    return Napi::Buffer<char>::New(env, result, size, [](Napi::Env, char *result) { delete[] result; });
+  }
+
+private:
+  pid_t handle;
+  uintptr_t address;
+  size_t size;
+  char *data;
+};
+
+class FindPatternWorker : public PromiseWorker
+{
+public:
+  FindPatternWorker(Napi::Env env, Napi::Value token, pid_t handle, std::string moduleName, std::string signature, short sigType, uint32_t patternOffset, uint32_t addressOffset, uint32_t skip)
+      : PromiseWorker(env, token), handle(handle), moduleName(moduleName), signature(signature), sigType(sigType), patternOffset(patternOffset), addressOffset(addressOffset), skip(skip) {}
+
+protected:
+  void Run() override
+  {
+    const char *errorMessage = "";
+    address = Pattern.findPatternInModule(handle, moduleName.c_str(), signature.c_str(), sigType, patternOffset, addressOffset, skip, &errorMessage, CancelFlag());
+
+    if (strcmp(errorMessage, ""))
+      SetError(errorMessage);
+    else if (address == (uintptr_t)-1)
+      SetError("unable to find module");
+    else if (address == (uintptr_t)-2)
+      SetError("no match found");
+  }
+
+  Napi::Value Resolve(Napi::Env env) override
+  {
+    return Napi::Value::From(env, address);
+  }
+
+private:
+  pid_t handle;
+  std::string moduleName;
+  std::string signature;
+  short sigType;
+  uint32_t patternOffset;
+  uint32_t addressOffset;
+  uint32_t skip;
+  uintptr_t address;
+};
+
+class FindPatternsWorker : public PromiseWorker
+{
+public:
+  FindPatternsWorker(Napi::Env env, Napi::Value token, pid_t handle, std::string moduleName, std::vector<pattern::request> &&requests)
+      : PromiseWorker(env, token), handle(handle), moduleName(moduleName), requests(std::move(requests)) {}
+
+protected:
+  void Run() override
+  {
+    const char *errorMessage = "";
+    if (!Pattern.findPatternsInModule(handle, moduleName.c_str(), requests, results, &errorMessage, CancelFlag()) && !strcmp(errorMessage, ""))
+      errorMessage = "unable to find module";
+
+    if (strcmp(errorMessage, ""))
+      SetError(errorMessage);
+  }
+
+  Napi::Value Resolve(Napi::Env env) override
+  {
+    return patternResults(env, results);
+  }
+
+private:
+  pid_t handle;
+  std::string moduleName;
+  std::vector<pattern::request> requests;
+  std::vector<uintptr_t> results;
+};
+
+class CreateScanSessionWorker : public PromiseWorker
+{
+public:
+  CreateScanSessionWorker(Napi::Env env, Napi::Value token, ValueScanRequest &&request)
+      : PromiseWorker(env, token), request(std::move(request)), sessionHandle(new ScanSessionHandle()) {}
+
+  // Still set if the scan failed or was cancelled
+  ~CreateScanSessionWorker() { delete sessionHandle; }
+
+protected:
+  void Run() override
+  {
+    sessionHandle->instance.reset(new scanSession(request.handle, request.type, request.alignment));
+    if (!startScanSession(sessionHandle->instance.get(), request, CancelFlag()))
+    {
+      SetError(scanSpaceError);
+    }
+  }
+
+  Napi::Value Resolve(Napi::Env env) override
+  {
+    ScanSessionHandle *result = sessionHandle;
+    sessionHandle = NULL;
+    return wrapScanSession(env, result);
+  }
+
+private:
+  ValueScanRequest request;
+  ScanSessionHandle *sessionHandle;
+};
+
+// Narrows a session on the threadpool. The session is marked busy until the promise settles,
+// and the worker keeps it from being collected in the meantime.
+class NextScanWorker : public PromiseWorker
+{
+public:
+  NextScanWorker(Napi::Env env, Napi::Value token, Napi::Value session, scanSession::predicate test, const unsigned char values[2][8])
+      : PromiseWorker(env, token), sessionReference(Napi::Persistent(session)), sessionHandle(session.As<Napi::External<ScanSessionHandle>>().Data()), test(test), remaining(0)
+  {
+    memcpy(this->values, values, sizeof(this->values));
+    sessionHandle->busy = true;
+  }
+
+protected:
+  void Run() override
+  {
+    if (!sessionHandle->instance->nextScan(test, values[0], values[1], CancelFlag()))
+    {
+      SetError(scanSpaceError);
+    }
+    remaining = sessionHandle->instance->count();
+  }
+
+  Napi::Value Resolve(Napi::Env env) override
+  {
+    return Napi::Value::From(env, (double)remaining);
+  }
+
+  void OnOK() override
+  {
+    sessionHandle->busy = false;
+    PromiseWorker::OnOK();
+  }
+
+  void OnError(const Napi::Error &error) override
+  {
+    sessionHandle->busy = false;
+    PromiseWorker::OnError(error);
+  }
+
+private:
+  Napi::Reference<Napi::Value> sessionReference;
+  ScanSessionHandle *sessionHandle;
+  scanSession::predicate test;
+  unsigned char values[2][8];
+  size_t remaining;
+};
+
+class CreatePointerMapWorker : public PromiseWorker
+{
+public:
+  CreatePointerMapWorker(Napi::Env env, Napi::Value token, pid_t handle, size_t pointerSize)
+      : PromiseWorker(env, token), handle(handle), pointerSize(pointerSize), map(new pointerScanner::pointerMap()) {}
+
+protected:
+  void Run() override
+  {
+    const char *errorMessage = "";
+    if (!pointerScanner::buildMap(handle, pointerSize, map.get(), &errorMessage, CancelFlag()))
+    {
+      SetError(errorMessage);
+    }
+  }
+
+  Napi::Value Resolve(Napi::Env env) override
+  {
+    return wrapPointerMap(env, map.release());
+  }
+
+private:
+  pid_t handle;
+  size_t pointerSize;
+  std::unique_ptr<pointerScanner::pointerMap> map;
+};
+
+// Searches a map on the threadpool. The map cannot be closed until the promise settles, and
+// the worker keeps it from being collected in the meantime.
+class FindPointerPathsWorker : public PromiseWorker
+{
+public:
+  FindPointerPathsWorker(Napi::Env env, Napi::Value token, Napi::Value map, uintptr_t address, const pointerScanner::searchOptions &options)
+      : PromiseWorker(env, token), mapReference(Napi::Persistent(map)), mapHandle(map.As<Napi::External<PointerMapHandle>>().Data()), address(address), options(options)
+  {
+    mapHandle->searches++;
+  }
+
+protected:
+  void Run() override
+  {
+    pointerScanner::findPaths(*mapHandle->instance, address, options, paths, CancelFlag());
+  }
+
+  Napi::Value Resolve(Napi::Env env) override
+  {
+    return pointerPathsResult(env, mapHandle->instance.get(), paths);
+  }
+
+  void OnOK() override
+  {
+    mapHandle->searches--;
+    PromiseWorker::OnOK();
+  }
+
+  void OnError(const Napi::Error &error) override
+  {
+    mapHandle->searches--;
+    PromiseWorker::OnError(error);
+  }
+
+private:
+  Napi::Reference<Napi::Value> mapReference;
+  PointerMapHandle *mapHandle;
+  uintptr_t address;
+  pointerScanner::searchOptions options;
+  std::vector<pointerScanner::path> paths;
+};
+
+// The promise-based functions take their usual arguments followed by an optional cancel token.
+
+Napi::Value findPatternsAsync(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (!args[0].IsNumber() || !args[1].IsString())
+  {
+    Napi::Error::New(env, "first argument must be a number, second argument must be a string").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::vector<pattern::request> requests;
+  if (!parsePatternRequests(env, args[2], requests))
+  {
+    return env.Null();
+  }
+
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  std::string moduleName(args[1].As<Napi::String>().Utf8Value());
+  return queuePromiseWorker(new FindPatternsWorker(env, args[3], handle, moduleName, std::move(requests)));
+}
+
+Napi::Value getProcessesAsync(const Napi::CallbackInfo &args)
+{
+  return queuePromiseWorker(new GetProcessesWorker(args.Env(), args[0]));
+}
+
+Napi::Value findModuleAsync(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (!args[0].IsString() || !args[1].IsNumber())
+  {
+    Napi::Error::New(env, "first argument must be a string, second argument must be a number").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::string moduleName(args[0].As<Napi::String>().Utf8Value());
+  return queuePromiseWorker(new FindModuleWorker(env, args[2], moduleName, args[1].As<Napi::Number>().Int32Value()));
+}
+
+Napi::Value readMemoryAsync(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (!args[0].IsNumber() || !args[1].IsNumber() || !args[2].IsString())
+  {
+    Napi::Error::New(env, "first and second argument must be a number, third argument must be a string").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::string dataType(args[2].As<Napi::String>().Utf8Value());
+  bool isString = dataType == "string" || dataType == "str";
+  memory::dataType type = memory::parseDataType(dataType.c_str());
+
+  if (!isString && type == memory::T_UNKNOWN)
+  {
+    Napi::Error::New(env, "unexpected data type").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  uintptr_t address = args[1].As<Napi::Number>().Int64Value();
+  return queuePromiseWorker(new ReadMemoryWorker(env, args[3], handle, address, type, isString));
+}
+
+Napi::Value readBufferAsync(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (!args[0].IsNumber() || !args[1].IsNumber() || !args[2].IsNumber())
+  {
+    Napi::Error::New(env, "first, second and third arguments must be a number").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  // The buffer is allocated on the threadpool, where a failed allocation cannot be thrown
+  double size = args[2].As<Napi::Number>().DoubleValue();
+  if (!(size >= 0) || size > (double)maxAsyncBufferSize || size != (double)(size_t)size)
+  {
+    Napi::Error::New(env, "size must be a whole number of bytes, at most 1GB").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  uintptr_t address = args[1].As<Napi::Number>().Int64Value();
+  return queuePromiseWorker(new ReadBufferWorker(env, args[3], handle, address, (size_t)size));
+}
+
+Napi::Value findPatternAsync(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (!args[0].IsNumber() || !args[1].IsString() || !args[2].IsString() || !args[3].IsNumber() || !args[4].IsNumber() || !args[5].IsNumber() || !args[6].IsNumber())
+  {
+    Napi::Error::New(env, "expected handle, module name, signature, signature type, pattern offset, address offset and skip").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  std::string moduleName(args[1].As<Napi::String>().Utf8Value());
+  std::string signature(args[2].As<Napi::String>().Utf8Value());
+  short sigType = args[3].As<Napi::Number>().Int32Value();
+  uint32_t patternOffset = args[4].As<Napi::Number>().Int32Value();
+  uint32_t addressOffset = args[5].As<Napi::Number>().Int32Value();
+  uint32_t skip = args[6].As<Napi::Number>().Int32Value();
+
+  return queuePromiseWorker(new FindPatternWorker(env, args[7], handle, moduleName, signature, sigType, patternOffset, addressOffset, skip));
+}
+
+Napi::Value createScanSessionAsync(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  ValueScanRequest request;
+  if (!parseScanSession(args, &request))
+  {
+    return env.Null();
+  }
+
+  return queuePromiseWorker(new CreateScanSessionWorker(env, args[4], std::move(request)));
+}
+
+// Takes the same arguments as nextScan followed by an optional cancel token. A cancelled
+// scan leaves the candidates as they were.
+Napi::Value nextScanAsync(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() < 2 || !args[1].IsString())
+  {
+    Napi::Error::New(env, "requires a scan session, a predicate and the values the predicate compares with").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  scanSession *session = unwrapScanSession(env, args[0]);
+  if (session == NULL)
+  {
+    return env.Null();
+  }
+
+  scanSession::predicate test;
+  unsigned char values[2][8] = {};
+  int operands = parseNextScan(args, *session, &test, values);
+  if (operands < 0)
+  {
+    return env.Null();
+  }
+
+  return queuePromiseWorker(new NextScanWorker(env, args[2 + operands], args[0], test, values));
+}
+
+Napi::Value createPointerMapAsync(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (!args[0].IsNumber())
+  {
+    Napi::Error::New(env, "first argument must be a number").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  size_t pointerSize;
+  if (!parsePointerSize(args, 1, pointerSize))
+  {
+    return env.Null();
+  }
+
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+  return queuePromiseWorker(new CreatePointerMapWorker(env, args[2], handle, pointerSize));
+}
+
+// Takes a pointer map, an address, the options of findPointerPaths and an optional cancel
+// token. A cancelled search rejects without the paths found so far.
+Napi::Value findPointerPathsAsync(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (unwrapPointerMap(env, args[0]) == NULL)
+  {
+    return env.Null();
+  }
+
+  uintptr_t address;
+  pointerScanner::searchOptions options;
+  if (!parsePointerSearch(args, &address, &options))
+  {
+    return env.Null();
+  }
+
+  return queuePromiseWorker(new FindPointerPathsWorker(env, args[3], args[0], address, options));
+}
+
+// A native watcher together with the thread-safe function its changes are delivered through
+struct WatcherHandle
+{
+  Napi::ThreadSafeFunction onChange;
+  std::unique_ptr<watcher> instance;
+  // onChange only keeps the event loop alive while addresses are watched. Otherwise its
+  // reference to the callback, which holds the JS Watcher, would keep the process running
+  // for as long as a Watcher that was never stopped exists.
+  size_t watched = 0;
+
+  void Stop()
+  {
+    if (instance)
+    {
+      instance->stop();
+      instance.reset();
+      onChange.Release();
+    }
+  }
+};
+
+// Fetches the watcher created by createWatcher, throwing and returning NULL if `value` is not one
+WatcherHandle *watcherFrom(Napi::Env env, Napi::Value value)
+{
+  if (!isTagged(env, value, watcherTag))
+  {
+    Napi::Error::New(env, "expected a watcher created by createWatcher").ThrowAsJavaScriptException();
+    return NULL;
+  }
+
+  return value.As<Napi::External<WatcherHandle>>().Data();
+}
+
+Napi::Value createWatcher(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 2 || !args[0].IsNumber() || !args[1].IsFunction())
+  {
+    Napi::Error::New(env, "requires 2 arguments, a handle and a function to receive changes").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  pid_t handle = (pid_t)args[0].As<Napi::Number>().Int64Value();
+
+  WatcherHandle *watcherHandle = new WatcherHandle();
+  watcherHandle->onChange = Napi::ThreadSafeFunction::New(env, args[1].As<Napi::Function>(), "memoryjs watcher", 0, 1);
+  watcherHandle->onChange.Unref(env);
+
+  Napi::ThreadSafeFunction onChange = watcherHandle->onChange;
+  watcherHandle->instance.reset(new watcher(handle, [onChange](std::vector<watcher::change> &&changes) {
+    std::vector<watcher::change> *report = new std::vector<watcher::change>(std::move(changes));
+
+    napi_status status = onChange.NonBlockingCall(report, [](Napi::Env env, Napi::Function callback, std::vector<watcher::change> *report) {
+      Napi::Array results = Napi::Array::New(env, report->size());
+      for (size_t i = 0; i < report->size(); i++)
+      {
+        const watcher::change &change = (*report)[i];
+        Napi::Object result = Napi::Object::New(env);
+        result.Set(Napi::String::New(env, "id"), Napi::Value::From(env, change.id));
+        result.Set(Napi::String::New(env, "address"), Napi::Value::From(env, change.address));
+        result.Set(Napi::String::New(env, "value"), change.ok ? decodeValue(env, change.type, change.value) : env.Null());
+        results.Set(i, result);
+      }
+      delete report;
+
+      callback.Call({results});
+    });
+
+    // The function is being released, nobody is listening any more
+    if (status != napi_ok)
+      delete report;
+  }));
+
+  Napi::External<WatcherHandle> external = Napi::External<WatcherHandle>::New(env, watcherHandle, [](Napi::Env, WatcherHandle *watcherHandle) {
+    watcherHandle->Stop();
+    delete watcherHandle;
+  });
+  return tagExternal(env, external, watcherTag);
+}
+
+Napi::Value watchAddress(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 4 || !args[1].IsNumber() || !args[2].IsString() || !args[3].IsNumber())
+  {
+    Napi::Error::New(env, "requires 4 arguments, a watcher, an address, a data type and an interval").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  WatcherHandle *watcherHandle = watcherFrom(env, args[0]);
+  if (watcherHandle == NULL)
+  {
+    return env.Null();
+  }
+
+  if (!watcherHandle->instance)
+  {
+    Napi::Error::New(env, "watcher has been stopped").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::string typeName(args[2].As<Napi::String>().Utf8Value());
+  memory::dataType type = memory::parseDataType(typeName.c_str());
+  if (type == memory::T_UNKNOWN)
+  {
+    Napi::Error::New(env, "unexpected data type").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  uintptr_t address = args[1].As<Napi::Number>().Int64Value();
+  uint32_t interval = args[3].As<Napi::Number>().Uint32Value();
+
+  if (watcherHandle->watched++ == 0)
+  {
+    watcherHandle->onChange.Ref(env);
+  }
+
+  return Napi::Value::From(env, watcherHandle->instance->add(address, type, interval));
+}
+
+Napi::Value unwatchAddress(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  if (args.Length() != 2 || !args[1].IsNumber())
+  {
+    Napi::Error::New(env, "requires 2 arguments, a watcher and an id").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  WatcherHandle *watcherHandle = watcherFrom(env, args[0]);
+  if (watcherHandle == NULL)
+  {
+    return env.Null();
+  }
+
+  bool removed = watcherHandle->instance && watcherHandle->instance->remove(args[1].As<Napi::Number>().Uint32Value());
+  if (removed && --watcherHandle->watched == 0)
+  {
+    watcherHandle->onChange.Unref(env);
+  }
+
+  return Napi::Boolean::New(env, removed);
+}
+
+Napi::Value stopWatcher(const Napi::CallbackInfo &args)
+{
+  Napi::Env env = args.Env();
+
+  WatcherHandle *watcherHandle = watcherFrom(env, args[0]);
+  if (watcherHandle != NULL)
+  {
+    watcherHandle->Stop();
+  }
+
+  return env.Null();
 }
 
 Napi::Value getProcessPath(const Napi::CallbackInfo &args)
@@ -589,11 +3456,57 @@ Napi::Object init(Napi::Env env, Napi::Object exports)
   exports.Set(Napi::String::New(env, "openProcess"), Napi::Function::New(env, openProcess));
   exports.Set(Napi::String::New(env, "getProcesses"), Napi::Function::New(env, getProcesses));
   exports.Set(Napi::String::New(env, "closeProcess"), Napi::Function::New(env, closeProcess));
+  exports.Set(Napi::String::New(env, "setReadBackend"), Napi::Function::New(env, setReadBackend));
+  exports.Set(Napi::String::New(env, "getReadBackend"), Napi::Function::New(env, getReadBackend));
+  exports.Set(Napi::String::New(env, "setScanOptions"), Napi::Function::New(env, setScanOptions));
+  exports.Set(Napi::String::New(env, "getScanOptions"), Napi::Function::New(env, getScanOptions));
+  exports.Set(Napi::String::New(env, "setSignatureCache"), Napi::Function::New(env, setSignatureCache));
   exports.Set(Napi::String::New(env, "findModule"), Napi::Function::New(env, findModule));
+  exports.Set(Napi::String::New(env, "getModules"), Napi::Function::New(env, getModules));
+  exports.Set(Napi::String::New(env, "getRegions"), Napi::Function::New(env, getRegions));
+  exports.Set(Napi::String::New(env, "getRegionTable"), Napi::Function::New(env, getRegionTable));
+  exports.Set(Napi::String::New(env, "findRegionForAddress"), Napi::Function::New(env, findRegionForAddress));
   exports.Set(Napi::String::New(env, "findPattern"), Napi::Function::New(env, findPattern));
+  exports.Set(Napi::String::New(env, "findPatterns"), Napi::Function::New(env, findPatterns));
+  exports.Set(Napi::String::New(env, "findPatternAll"), Napi::Function::New(env, findPatternAll));
+  exports.Set(Napi::String::New(env, "scanValue"), Napi::Function::New(env, scanValue));
+  exports.Set(Napi::String::New(env, "createScanSession"), Napi::Function::New(env, createScanSession));
+  exports.Set(Napi::String::New(env, "nextScan"), Napi::Function::New(env, nextScan));
+  exports.Set(Napi::String::New(env, "getScanResults"), Napi::Function::New(env, getScanResults));
+  exports.Set(Napi::String::New(env, "closeScanSession"), Napi::Function::New(env, closeScanSession));
   exports.Set(Napi::String::New(env, "readMemory"), Napi::Function::New(env, readMemory));
+  exports.Set(Napi::String::New(env, "readString"), Napi::Function::New(env, readString));
+  exports.Set(Napi::String::New(env, "readMemoryBatch"), Napi::Function::New(env, readMemoryBatch));
+  exports.Set(Napi::String::New(env, "readPointerChain"), Napi::Function::New(env, readPointerChain));
+  exports.Set(Napi::String::New(env, "readPointerChains"), Napi::Function::New(env, readPointerChains));
+  exports.Set(Napi::String::New(env, "createPointerMap"), Napi::Function::New(env, createPointerMap));
+  exports.Set(Napi::String::New(env, "findPointerPaths"), Napi::Function::New(env, findPointerPaths));
+  exports.Set(Napi::String::New(env, "savePointerMap"), Napi::Function::New(env, savePointerMap));
+  exports.Set(Napi::String::New(env, "loadPointerMap"), Napi::Function::New(env, loadPointerMap));
+  exports.Set(Napi::String::New(env, "closePointerMap"), Napi::Function::New(env, closePointerMap));
+  exports.Set(Napi::String::New(env, "defineStruct"), Napi::Function::New(env, defineStruct));
+  exports.Set(Napi::String::New(env, "readStruct"), Napi::Function::New(env, readStruct));
+  exports.Set(Napi::String::New(env, "readStructArray"), Napi::Function::New(env, readStructArray));
   exports.Set(Napi::String::New(env, "readBuffer"), Napi::Function::New(env, readBuffer));
+  exports.Set(Napi::String::New(env, "readBufferInto"), Napi::Function::New(env, readBufferInto));
+  exports.Set(Napi::String::New(env, "readBufferPartial"), Napi::Function::New(env, readBufferPartial));
   exports.Set(Napi::String::New(env, "getProcessPath"), Napi::Function::New(env, getProcessPath));
+  exports.Set(Napi::String::New(env, "createCancelToken"), Napi::Function::New(env, createCancelToken));
+  exports.Set(Napi::String::New(env, "cancel"), Napi::Function::New(env, cancel));
+  exports.Set(Napi::String::New(env, "getProcessesAsync"), Napi::Function::New(env, getProcessesAsync));
+  exports.Set(Napi::String::New(env, "findModuleAsync"), Napi::Function::New(env, findModuleAsync));
+  exports.Set(Napi::String::New(env, "readMemoryAsync"), Napi::Function::New(env, readMemoryAsync));
+  exports.Set(Napi::String::New(env, "readBufferAsync"), Napi::Function::New(env, readBufferAsync));
+  exports.Set(Napi::String::New(env, "findPatternAsync"), Napi::Function::New(env, findPatternAsync));
+  exports.Set(Napi::String::New(env, "findPatternsAsync"), Napi::Function::New(env, findPatternsAsync));
+  exports.Set(Napi::String::New(env, "createScanSessionAsync"), Napi::Function::New(env, createScanSessionAsync));
+  exports.Set(Napi::String::New(env, "nextScanAsync"), Napi::Function::New(env, nextScanAsync));
+  exports.Set(Napi::String::New(env, "createPointerMapAsync"), Napi::Function::New(env, createPointerMapAsync));
+  exports.Set(Napi::String::New(env, "findPointerPathsAsync"), Napi::Function::New(env, findPointerPathsAsync));
+  exports.Set(Napi::String::New(env, "createWatcher"), Napi::Function::New(env, createWatcher));
+  exports.Set(Napi::String::New(env, "watchAddress"), Napi::Function::New(env, watchAddress));
+  exports.Set(Napi::String::New(env, "unwatchAddress"), Napi::Function::New(env, unwatchAddress));
+  exports.Set(Napi::String::New(env, "stopWatcher"), Napi::Function::New(env, stopWatcher));
   exports.Set(Napi::String::New(env, "writeMemory"), Napi::Function::New(env, writeMemory));
   exports.Set(Napi::String::New(env, "writeBuffer"), Napi::Function::New(env, writeBuffer));
   exports.Set(Napi::String::New(env, "virtualProtectEx"), Napi::Function::New(env, virtualProtectEx));
@@ -1,55 +1,385 @@
 #include <node.h>
 #include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <algorithm>
 #include <cstring>
+#include <cerrno>
+#include <fcntl.h>
 #include "module.h"
 #include "process.h"
 #include "memoryjs.h"
 #include <cinttypes>
 
-std::vector<module::Module> module::getModules(pid_t processId, const char**  errorMessage) {
-    std::vector<Module> modules;
-    char prev_pathname[4096] = "unknown\0";
+namespace {
+    struct regionCache {
+        std::string text;
+        std::shared_ptr<const module::RegionTable> table;
+        // Value of useCounter when the map was last asked for
+        uint64_t lastUsed = 0;
+    };
 
-    char maps_path[4096];
-    snprintf(maps_path, sizeof(maps_path), "/proc/%d/maps", processId);
-    FILE *f = fopen(maps_path, "r");
+    // Handles are just pids, so the per-handle region maps live here. Lookups by pid (e.g.
+    // findModule) fill the cache without a handle that would release them, so only the
+    // most recently used maps are kept.
+    std::mutex cacheMutex;
+    std::unordered_map<pid_t, regionCache> caches;
+    uint64_t useCounter = 0;
+    const size_t maxCachedMaps = 32;
 
-    if (f == NULL) {
+    // Called with cacheMutex held before a map is added for a new pid
+    void evictLeastRecentlyUsed() {
+        if (caches.size() < maxCachedMaps) {
+            return;
+        }
+
+        auto oldest = caches.begin();
+        for (auto entry = caches.begin(); entry != caches.end(); ++entry) {
+            if (entry->second.lastUsed < oldest->second.lastUsed) {
+                oldest = entry;
+            }
+        }
+        caches.erase(oldest);
+    }
+
+    // Large enough for most processes to be read with a single read()
+    const size_t initialReadSize = 256 * 1024;
+
+    // Reads the whole maps file into `text`, growing it as needed. The buffer is reused
+    // between calls, so a process only costs allocations once its map grows.
+    bool readMaps(pid_t processId, std::string* text) {
+        char maps_path[64];
+        snprintf(maps_path, sizeof(maps_path), "/proc/%d/maps", processId);
+
+        int fd = open(maps_path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+
+        text->resize(text->capacity() > initialReadSize ? text->capacity() : initialReadSize);
+
+        size_t size = 0;
+        ssize_t rc = 0;
+        for (;;) {
+            if (size == text->size()) {
+                text->resize(text->size() * 2);
+            }
+
+            rc = read(fd, &(*text)[size], text->size() - size);
+            if (rc < 0 && errno == EINTR) {
+                continue;
+            }
+            if (rc <= 0) {
+                break;
+            }
+            size += rc;
+        }
+        close(fd);
+
+        text->resize(size);
+        return rc == 0;
+    }
+
+    inline uint64_t parseHex(const char*& p, const char* end) {
+        uint64_t value = 0;
+        for (; p < end; p++) {
+            unsigned digit = (unsigned char)*p - '0';
+            if (digit > 9) {
+                // Folds 'A'-'F' onto 'a'-'f'; anything else ends the number
+                digit = ((unsigned char)*p | 0x20) - 'a';
+                if (digit > 5) {
+                    break;
+                }
+                digit += 10;
+            }
+            value = (value << 4) | digit;
+        }
+        return value;
+    }
+
+    inline uint64_t parseDecimal(const char*& p, const char* end) {
+        uint64_t value = 0;
+        for (; p < end; p++) {
+            unsigned digit = (unsigned char)*p - '0';
+            if (digit > 9) {
+                break;
+            }
+            value = value * 10 + digit;
+        }
+        return value;
+    }
+
+    inline void skipSpaces(const char*& p, const char* end) {
+        while (p < end && *p == ' ') {
+            p++;
+        }
+    }
+
+    // Parses "start-end perms offset major:minor inode   path" up to `end` (the newline)
+    void parseMapsLine(const char* p, const char* end, module::RegionTable* table, module::Region* result) {
+        result->start = (uintptr_t)parseHex(p, end);
+        p++;
+        result->end = (uintptr_t)parseHex(p, end);
+        skipSpaces(p, end);
+
+        // "r-xp": each position is either its letter or '-', the last one is 'p' or 's'
+        result->permissions = 0;
+        if (end - p >= 4) {
+            result->permissions = (p[0] == 'r' ? module::P_READ : 0) | (p[1] == 'w' ? module::P_WRITE : 0) |
+                                  (p[2] == 'x' ? module::P_EXECUTE : 0) | (p[3] == 's' ? module::P_SHARED : 0);
+        }
+        while (p < end && *p != ' ') {
+            p++;
+        }
+        skipSpaces(p, end);
+
+        result->offset = parseHex(p, end);
+        skipSpaces(p, end);
+        uint32_t major = (uint32_t)parseHex(p, end);
+        p++;
+        uint32_t minor = (uint32_t)parseHex(p, end);
+        result->dev = (major << 20) | (minor & 0xFFFFF);
+        skipSpaces(p, end);
+        result->inode = parseDecimal(p, end);
+        skipSpaces(p, end);
+
+        // Anonymous mappings have no path and get the empty one
+        result->path = end > p ? table->intern(p, end - p) : 0;
+    }
+
+    size_t countLines(const char* p, const char* end) {
+        size_t lines = 0;
+        while ((p = (const char*)memchr(p, '\n', end - p)) != NULL) {
+            lines++;
+            p++;
+        }
+        return lines;
+    }
+}
+
+module::RegionTable::RegionTable() {
+    paths.push_back("");
+    pathIndex[""] = 0;
+}
+
+uint32_t module::RegionTable::intern(const char* path, size_t length) {
+    std::string key(path, length);
+
+    auto entry = pathIndex.find(key);
+    if (entry != pathIndex.end()) {
+        return entry->second;
+    }
+
+    uint32_t index = (uint32_t)paths.size();
+    paths.push_back(key);
+    pathIndex.emplace(std::move(key), index);
+    return index;
+}
+
+void module::permissionString(uint32_t permissions, char* result) {
+    result[0] = permissions & P_READ ? 'r' : '-';
+    result[1] = permissions & P_WRITE ? 'w' : '-';
+    result[2] = permissions & P_EXECUTE ? 'x' : '-';
+    result[3] = permissions & P_SHARED ? 's' : 'p';
+    result[4] = '\0';
+}
+
+size_t module::parseMaps(const char* text, size_t size, RegionTable* table) {
+    const char* p = text;
+    const char* end = text + size;
+    size_t count = 0;
+
+    while (p < end) {
+        const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+        if (lineEnd == NULL) {
+            lineEnd = end;
+        }
+
+        if (lineEnd > p) {
+            Region region;
+            parseMapsLine(p, lineEnd, table, &region);
+            table->regions.push_back(region);
+            count++;
+        }
+        p = lineEnd + 1;
+    }
+
+    return count;
+}
+
+std::shared_ptr<const module::RegionTable> module::getRegionMap(pid_t processId, const char** errorMessage) {
+    // Each thread keeps its own read buffer; it is swapped with the cached text when the map changed
+    thread_local std::string text;
+
+    if (!readMaps(processId, &text)) {
+        // The process is gone (or out of reach), so is any map cached for it
+        releaseRegionMap(processId);
         *errorMessage = "cannot open /proc/.../maps";
-        return modules;
+        return std::make_shared<const RegionTable>();
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (caches.find(processId) == caches.end()) {
+        evictLeastRecentlyUsed();
+    }
+
+    regionCache& cache = caches[processId];
+    cache.lastUsed = ++useCounter;
+
+    if (cache.table != NULL && cache.text == text) {
+        return cache.table;
+    }
+
+    // Mappings are listed in address order and usually only change in a few places
+    // (the heap growing, a library being loaded), so the unchanged lines at the start
+    // and end keep their parsed entries and only the lines in between are parsed again.
+    const char* current = text.data();
+    size_t prefixEnd = 0;
+    size_t suffixStart = text.size();
+    size_t prefixLines = 0;
+    size_t suffixLines = 0;
+
+    if (cache.table != NULL) {
+        const std::string& previous = cache.text;
+        const size_t common = text.size() < previous.size() ? text.size() : previous.size();
+
+        size_t prefix = 0;
+        while (prefix < common && current[prefix] == previous[prefix]) {
+            prefix++;
+        }
+
+        // Back off to the end of the last complete line both texts share
+        prefixEnd = prefix;
+        while (prefixEnd > 0 && current[prefixEnd - 1] != '\n') {
+            prefixEnd--;
+        }
+
+        size_t suffix = 0;
+        while (suffix < common - prefixEnd && current[text.size() - 1 - suffix] == previous[previous.size() - 1 - suffix]) {
+            suffix++;
+        }
+
+        // Move forward to the first line that starts inside the shared suffix
+        const char* lineStart = (const char*)memchr(current + text.size() - suffix, '\n', suffix);
+        suffixStart = lineStart != NULL ? lineStart + 1 - current : text.size();
+
+        prefixLines = countLines(current, current + prefixEnd);
+        suffixLines = countLines(current + suffixStart, current + text.size());
+    }
+
+    std::shared_ptr<RegionTable> table = std::make_shared<RegionTable>();
+    table->regions.reserve(prefixLines + suffixLines + countLines(current + prefixEnd, current + suffixStart) + 1);
+
+    // Kept regions refer to the previous table's paths. Only the paths they still use are
+    // interned again, so the paths of files that were unmapped are not carried along.
+    std::vector<uint32_t> carried(cache.table != NULL ? cache.table->paths.size() : 0, 0);
+    auto keep = [&](std::vector<Region>::const_iterator from, std::vector<Region>::const_iterator to) {
+        for (; from != to; ++from) {
+            Region region = *from;
+            if (region.path != 0) {
+                uint32_t& path = carried[region.path];
+                if (path == 0) {
+                    const std::string& previous = cache.table->paths[region.path];
+                    path = table->intern(previous.data(), previous.size());
+                }
+                region.path = path;
+            }
+            table->regions.push_back(region);
+        }
+    };
+
+    if (prefixLines > 0) {
+        keep(cache.table->regions.begin(), cache.table->regions.begin() + prefixLines);
+    }
+    parseMaps(current + prefixEnd, suffixStart - prefixEnd, table.get());
+    if (suffixLines > 0) {
+        keep(cache.table->regions.end() - suffixLines, cache.table->regions.end());
     }
 
-    size_t len = 0;
-    char *line = NULL;
-    ssize_t rc = 0;
-    while ((rc = getline(&line, &len, f)) != -1) {
-        if (rc < 1) {
+    cache.text.swap(text);
+    cache.table = table;
+    return cache.table;
+}
+
+void module::releaseRegionMap(pid_t processId) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    caches.erase(processId);
+}
+
+void module::findRegions(const RegionTable& table, const uintptr_t* addresses, size_t count, int32_t* indices) {
+    const std::vector<Region>& regions = table.regions;
+    size_t from = 0;
+    uintptr_t previous = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const uintptr_t address = addresses[i];
+        if (address < previous) {
+            from = 0;
+        }
+        previous = address;
+
+        // First region that starts after the address; the one before it is the candidate
+        auto next = std::upper_bound(regions.begin() + from, regions.end(), address,
+                                     [](uintptr_t value, const Region& region) { return value < region.start; });
+        size_t candidate = next - regions.begin();
+
+        if (candidate == 0 || address >= regions[candidate - 1].end) {
+            indices[i] = -1;
+            from = candidate > 0 ? candidate - 1 : 0;
             continue;
         }
-        line[rc-1] = '\0';
+
+        indices[i] = (int32_t)(candidate - 1);
+        from = candidate - 1;
+    }
+}
+
+size_t module::moduleStart(const RegionTable& table, size_t index) {
+    const std::vector<Region>& regions = table.regions;
+
+    // An anonymous mapping right after a file's mappings is its .bss and has the same base
+    if (regions[index].inode == 0 && regions[index].path == 0 && index > 0 &&
+        regions[index - 1].inode != 0 && regions[index - 1].end == regions[index].start) {
+        index--;
+    }
+
+    const Region& region = regions[index];
+    if (region.inode == 0) {
+        return index;
+    }
+
+    while (index > 0 && regions[index - 1].path == region.path && regions[index - 1].inode == region.inode) {
+        index--;
+    }
+    return index;
+}
+
+std::vector<module::Region> module::getModules(pid_t processId, const char**  errorMessage, std::shared_ptr<const RegionTable>* table) {
+    std::vector<Region> modules;
+    uint32_t prev_path = 0;
+
+    *table = getRegionMap(processId, errorMessage);
+
+    for (const Region& region : (*table)->regions) {
+        const char* pathname = (*table)->pathname(region);
 
         // Skip '[heap]', '[stack]', etc.
         // Probably don't need these right now.
-        if (strchr(line, '[') != NULL) {
+        if (strchr(pathname, '[') != NULL) {
             continue;
         }
 
-        Module result;
-
-        sscanf(line, "%" SCNxPTR "-%" SCNxPTR " %31s %llx %x:%x %llu", &result.start,
-              &result.end, result.permissions, &result.offset,
-              &result.dev_major, &result.dev_minor, &result.inode);
-
-        // If the line doesn't have a path, simply add a dummy value to pathname.
-        if (strchr(line, '/') != NULL) {
-            strcpy(prev_pathname, strchr(line, '/'));
+        // Anonymous mappings take the path of the file mapped before them
+        if (strchr(pathname, '/') != NULL) {
+            prev_path = region.path;
         }
-        strcpy(result.pathname, prev_pathname);
 
+        Region result = region;
+        result.path = prev_path;
         modules.push_back(result);
     }
-    free(line);
-    fclose(f);
 
     return modules;
 }
@@ -58,41 +388,32 @@ module::Module module::findModule(const char* moduleName, pid_t processId, const
     module::Module result;
     bool found = false;
 
-    char maps_path[4096];
-    snprintf(maps_path, sizeof(maps_path), "/proc/%d/maps", processId);
-    FILE *f = fopen(maps_path, "r");
+    std::shared_ptr<const RegionTable> table = getRegionMap(processId, errorMessage);
 
-    if (f == NULL) {
-        *errorMessage = "cannot open /proc/.../maps";
+    if (strcmp(*errorMessage, "")) {
         return result;
     }
 
-    size_t len = 0;
-    char *line = NULL;
-    ssize_t rc = 0;
-    while ((rc = getline(&line, &len, f)) != -1) {
-        // Remove trailing \n
-        if (rc < 1) {
-            continue;
-        }
-        line[rc-1] = '\0';
+    for (const Region& region : table->regions) {
+        const char* pathname = table->pathname(region);
 
-        // Search if the moduleName appears *anywhere* in the line
-        if (strstr(line, moduleName) == NULL) {
+        // Search if the moduleName appears anywhere in the path
+        if (strchr(pathname, '/') == NULL || strstr(pathname, moduleName) == NULL) {
             continue;
         }
 
-        sscanf(line, "%" SCNxPTR "-%" SCNxPTR " %31s %llx %x:%x %llu", &result.start,
-              &result.end, result.permissions, &result.offset,
-              &result.dev_major, &result.dev_minor, &result.inode);
-
-        strcpy(result.pathname, strchr(line,'/'));
+        result.start = region.start;
+        result.end = region.end;
+        permissionString(region.permissions, result.permissions);
+        result.offset = region.offset;
+        result.dev_major = region.dev >> 20;
+        result.dev_minor = region.dev & 0xFFFFF;
+        result.inode = region.inode;
+        snprintf(result.pathname, sizeof(result.pathname), "%s", strchr(pathname, '/'));
 
         found = true;
         break;
     }
-    free(line);
-    fclose(f);
 
     if (!found) {
         *errorMessage = "unable to find module";
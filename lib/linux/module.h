@@ -4,6 +4,9 @@
 
 #include <node.h>
 #include <vector>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <unistd.h>
 #include <cstdint>
 #include <stdlib.h>
@@ -21,8 +24,69 @@ namespace module {
         char pathname[4096];
     };
 
+    // Access bits of a mapping, decoded from its "rwxp"/"rwxs" permission string
+    enum permission {
+        P_READ = 0x1,
+        P_WRITE = 0x2,
+        P_EXECUTE = 0x4,
+        P_SHARED = 0x8,
+    };
+
+    // One line of /proc/<pid>/maps. The path is kept once per table and referred to by index.
+    struct Region {
+        uintptr_t start;
+        uintptr_t end;
+        unsigned long long offset;
+        unsigned long long inode;
+        // major << 20 | minor, like the kernel's dev_t
+        uint32_t dev;
+        uint32_t path;
+        uint32_t permissions;
+    };
+
+    struct RegionTable {
+        std::vector<Region> regions;
+        // Interned paths; paths[0] is the empty path of anonymous mappings
+        std::vector<std::string> paths;
+        std::unordered_map<std::string, uint32_t> pathIndex;
+
+        RegionTable();
+        uint32_t intern(const char* path, size_t length);
+        const char* pathname(const Region& region) const { return paths[region.path].c_str(); }
+    };
+
     Module findModule(const char* moduleName, pid_t processId, const char** errorMessage);
-    std::vector<Module> getModules(pid_t processId, const char**  errorMessage);
+
+    // Every mapping but [heap], [stack] etc. An anonymous mapping takes the path of the
+    // last file mapped before it, however far back, so a file's .bss counts as part of it.
+    // Anonymous mappings before the first file keep path 0, see modulePath. Paths refer to
+    // `table`, which is set to the table the regions were taken from.
+    std::vector<Region> getModules(pid_t processId, const char** errorMessage, std::shared_ptr<const RegionTable>* table);
+
+    // Path of a region returned by getModules, "unknown" for those before the first file
+    inline const char* modulePath(const RegionTable& table, const Region& region) {
+        return region.path == 0 ? "unknown" : table.pathname(region);
+    }
+
+    // Every mapping of the process, including [heap], [stack] and anonymous ones. The
+    // table is kept per handle and only re-parsed where /proc/<pid>/maps changed since
+    // the last call.
+    std::shared_ptr<const RegionTable> getRegionMap(pid_t processId, const char** errorMessage);
+    void releaseRegionMap(pid_t processId);
+
+    // Index of the region containing each address, or -1 if it is not mapped. Regions are
+    // sorted and disjoint, so each lookup is a binary search; while the addresses ascend, the
+    // search only covers the regions after the previous result.
+    void findRegions(const RegionTable& table, const uintptr_t* addresses, size_t count, int32_t* indices);
+    // Index of the first of the consecutive regions mapped from the same file as `index`
+    // (the module base), or `index` itself for anonymous and special mappings. An anonymous
+    // mapping right after a file mapping (its .bss) belongs to that file.
+    size_t moduleStart(const RegionTable& table, size_t index);
+
+    // Appends an entry for every line of maps-formatted `text`, returns how many were added.
+    size_t parseMaps(const char* text, size_t size, RegionTable* table);
+    // Writes the "rwxp" form of permission bits into `result` (at least 5 bytes).
+    void permissionString(uint32_t permissions, char* result);
     char* getFilePath(pid_t processId);
 }
 
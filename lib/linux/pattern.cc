@@ -1,5 +1,8 @@
 #include <node.h>
 #include <vector>
+#include <mutex>
+#include <memory>
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
 #include <sys/uio.h>
@@ -8,55 +11,626 @@
 #include "memoryjs.h"
 #include "process.h"
 #include "memory.h"
+#include "signaturecache.h"
 
-#define INRANGE(x,a,b) (x >= a && x <= b) 
-#define getBits( x ) (INRANGE(x,'0','9') ? (x - '0') : ((x&(~0x20)) - 'A' + 0xa))
-#define getByte( x ) (getBits(x[0]) << 4 | getBits(x[1]))
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PATTERN_X86
+#endif
 
 pattern::pattern() {}
 pattern::~pattern() {}
 
-/* based off Y3t1y3t's implementation */
-uintptr_t pattern::findPattern(pid_t hProcess, module::Module module, uintptr_t baseAddress, const char* pattern, short sigType, uintptr_t patternOffset, uintptr_t addressOffset, uint32_t skip) { 
-  memory Memory;
-  auto moduleSize = uintptr_t(module.end - module.start);
-  auto moduleBase = uintptr_t(module.start);
+namespace {
+  // Bytes that are common in x86 machine code, most common first. Anchoring on
+  // anything else keeps the number of candidates that need a full compare low.
+  const unsigned char commonBytes[] = {
+    0x00, 0xFF, 0x48, 0x8B, 0xCC, 0x89, 0x0F, 0x24, 0x83, 0x44, 0xE8, 0x4C, 0x01, 0x8D, 0x85, 0xC0,
+    0x74, 0x45, 0x10, 0x08, 0x20, 0x90, 0xC3, 0x75, 0x04, 0xEB, 0x40, 0x49, 0x41, 0x4D, 0x02, 0x03
+  };
+
+  size_t byteRank(unsigned char byte) {
+    for (size_t i = 0; i < sizeof(commonBytes); i++) {
+      if (commonBytes[i] == byte) return i;
+    }
+    return sizeof(commonBytes);
+  }
+
+  int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 0xa;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 0xa;
+    return -1;
+  }
+
+  // Full masked compare of a candidate
+  inline bool matchesAt(const pattern::signature& sig, const unsigned char* data) {
+    const unsigned char* bytes = sig.bytes.data();
+    const unsigned char* mask = sig.mask.data();
+    const size_t length = sig.bytes.size();
+    size_t i = 0;
+
+#ifdef __SSE2__
+    for (; i + 16 <= length; i += 16) {
+      __m128i value = _mm_and_si128(_mm_loadu_si128((const __m128i*)(data + i)), _mm_loadu_si128((const __m128i*)(mask + i)));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(value, _mm_loadu_si128((const __m128i*)(bytes + i)))) != 0xFFFF) return false;
+    }
+#endif
+
+    for (; i + 8 <= length; i += 8) {
+      uint64_t value, valueMask, expected;
+      memcpy(&value, data + i, 8);
+      memcpy(&valueMask, mask + i, 8);
+      memcpy(&expected, bytes + i, 8);
+      if ((value & valueMask) != expected) return false;
+    }
+
+    for (; i < length; i++) {
+      if ((data[i] & mask[i]) != bytes[i]) return false;
+    }
+
+    return true;
+  }
+
+  // `to` has already been clamped so that every candidate fits in the buffer
+  size_t scanScalar(const pattern::signature& sig, const unsigned char* data, size_t from, size_t to) {
+    const size_t anchor = sig.anchors[0];
+    const unsigned char value = sig.bytes[anchor];
+
+    for (size_t position = from; position < to; position++) {
+      // memchr is vectorised by libc, so this skips ahead quickly
+      const unsigned char* hit = (const unsigned char*)memchr(data + position + anchor, value, to - position);
+      if (hit == NULL) return pattern::NO_MATCH;
+
+      position = hit - data - anchor;
+      if (matchesAt(sig, data + position)) return position;
+    }
+
+    return pattern::NO_MATCH;
+  }
+
+#ifdef PATTERN_X86
+  // Both anchors are compared for a whole vector of candidate positions at once;
+  // only positions where both match get a full compare.
+  __attribute__((target("sse2")))
+  size_t scanSse2(const pattern::signature& sig, const unsigned char* data, size_t from, size_t to) {
+    const __m128i first = _mm_set1_epi8((char)sig.bytes[sig.anchors[0]]);
+    const __m128i second = _mm_set1_epi8((char)sig.bytes[sig.anchors[1]]);
 
-  auto moduleBytes = std::vector<unsigned char>(moduleSize);
+    size_t position = from;
+    for (; position + 16 <= to; position += 16) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(data + position + sig.anchors[0]));
+      __m128i b = _mm_loadu_si128((const __m128i*)(data + position + sig.anchors[1]));
+      unsigned int candidates = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, second)));
 
-  Memory.readMemoryData(hProcess, moduleBase, &moduleBytes[0], moduleSize);
+      while (candidates != 0) {
+        size_t candidate = position + __builtin_ctz(candidates);
+        if (matchesAt(sig, data + candidate)) return candidate;
+        candidates &= candidates - 1;
+      }
+    }
 
-  auto byteBase = const_cast<unsigned char*>(&moduleBytes.at(0));
-  auto skipIndex = 0;
-  for (auto offset = 0UL; offset < moduleSize; ++offset) {
-    if (compareBytes(byteBase + offset, pattern) && skipIndex++ >= skip) {
-      auto address = moduleBase + offset + patternOffset;
+    return scanScalar(sig, data, position, to);
+  }
 
-      /* read memory at pattern if flag is raised*/
-      if (sigType & ST_READ) Memory.readMemoryData(hProcess, address, &address, sizeof(uintptr_t));
+  __attribute__((target("avx2")))
+  size_t scanAvx2(const pattern::signature& sig, const unsigned char* data, size_t from, size_t to) {
+    const __m256i first = _mm256_set1_epi8((char)sig.bytes[sig.anchors[0]]);
+    const __m256i second = _mm256_set1_epi8((char)sig.bytes[sig.anchors[1]]);
 
-      /* subtract image base if flag is raised */
-      if (sigType & ST_SUBTRACT) address -= baseAddress;
+    size_t position = from;
+    for (; position + 32 <= to; position += 32) {
+      __m256i a = _mm256_loadu_si256((const __m256i*)(data + position + sig.anchors[0]));
+      __m256i b = _mm256_loadu_si256((const __m256i*)(data + position + sig.anchors[1]));
+      unsigned int candidates = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, second)));
 
-      return address + addressOffset;
+      while (candidates != 0) {
+        size_t candidate = position + __builtin_ctz(candidates);
+        if (matchesAt(sig, data + candidate)) return candidate;
+        candidates &= candidates - 1;
+      }
     }
+
+    return scanScalar(sig, data, position, to);
+  }
+#endif
+
+  typedef size_t (*scanFunction)(const pattern::signature& sig, const unsigned char* data, size_t from, size_t to);
+
+  // Picks the widest implementation the CPU supports
+  scanFunction selectScan() {
+#ifdef PATTERN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return scanAvx2;
+    if (__builtin_cpu_supports("sse2")) return scanSse2;
+#endif
+    return scanScalar;
   }
+}
+
+bool pattern::compileSignature(const char* pattern, signature* result) {
+  result->bytes.clear();
+  result->mask.clear();
+
+  // Every '?' is one wildcard byte, every pair of hex digits one fixed byte
+  for (const char* c = pattern; *c; c++) {
+    if (*c == ' ') continue;
+
+    if (*c == '?') {
+      result->bytes.push_back(0);
+      result->mask.push_back(0);
+      continue;
+    }
+
+    int high = hexValue(c[0]);
+    int low = high < 0 ? -1 : hexValue(c[1]);
+    if (low < 0) return false;
+
+    result->bytes.push_back((unsigned char)(high << 4 | low));
+    result->mask.push_back(0xFF);
+    c++;
+  }
+
+  if (result->bytes.empty()) return false;
+
+  // Pick the two least common fixed bytes as anchors
+  size_t best = NO_MATCH;
+  size_t second = NO_MATCH;
+  result->fixedCount = 0;
+  for (size_t i = 0; i < result->bytes.size(); i++) {
+    if (result->mask[i] == 0) continue;
+    result->fixedCount++;
+
+    size_t rank = byteRank(result->bytes[i]);
+    if (best == NO_MATCH || rank > byteRank(result->bytes[best])) {
+      second = best;
+      best = i;
+    } else if (second == NO_MATCH || rank > byteRank(result->bytes[second])) {
+      second = i;
+    }
+  }
+
+  result->anchors[0] = best == NO_MATCH ? 0 : best;
+  result->anchors[1] = second == NO_MATCH ? result->anchors[0] : second;
+  return true;
+}
+
+size_t pattern::scan(const signature& sig, const unsigned char* data, size_t size, size_t from, size_t to) {
+  static const scanFunction scanImplementation = selectScan();
+
+  const size_t length = sig.bytes.size();
+  if (length > size) return NO_MATCH;
+  if (to > size - length + 1) to = size - length + 1;
+  if (from >= to) return NO_MATCH;
+
+  // A signature made only of wildcards matches everywhere
+  if (sig.fixedCount == 0) return from;
+
+  return scanImplementation(sig, data, from, to);
+}
+
+uintptr_t pattern::findPattern(pid_t hProcess, module::Module module, uintptr_t baseAddress, const char* pattern, short sigType, uintptr_t patternOffset, uintptr_t addressOffset, uint32_t skip, const std::atomic<bool>* cancelled) {
+  signature sig;
+  if (!compileSignature(pattern, &sig)) return -2;
+
+  return findPattern(hProcess, module, baseAddress, sig, sigType, patternOffset, addressOffset, skip, cancelled);
+}
+
+uintptr_t pattern::findPattern(pid_t hProcess, module::Module module, uintptr_t baseAddress, const signature& sig, short sigType, uintptr_t patternOffset, uintptr_t addressOffset, uint32_t skip, const std::atomic<bool>* cancelled) {
+  std::vector<scanner::range> ranges = { { module.start, module.end } };
+  uintptr_t match = findMatchInRanges(hProcess, ranges, sig, skip, cancelled);
+  if (match == (uintptr_t)-2) return -2;
+
+  return resolveMatch(hProcess, match, baseAddress, sigType, patternOffset, addressOffset);
+}
+
+/* based off Y3t1y3t's implementation */
+uintptr_t pattern::findMatchInRanges(pid_t hProcess, const std::vector<scanner::range>& ranges, const signature& sig, uint32_t skip, const std::atomic<bool>* cancelled) {
+  struct chunkMatches {
+    bool done;
+    size_t range;
+    std::vector<uintptr_t> addresses;
+  };
+
+  // Chunks finish out of order, so matches are only counted once every chunk before
+  // them has finished (the frontier). That keeps `skip` counting in address order.
+  std::mutex mutex;
+  std::vector<chunkMatches> chunks;
+  size_t frontier = 0;
+  size_t frontierRange = (size_t)-1;
+  uint32_t skipIndex = 0;
+  bool found = false;
+  uintptr_t match = 0;
+
+  scanner::forEachChunk(hProcess, ranges, sig.bytes.size() - 1, [&](const scanner::chunk& current) {
+    // No range needs more than skip + 1 matches, so neither does any chunk
+    std::vector<uintptr_t> addresses;
+    for (size_t offset = 0; addresses.size() <= skip;) {
+      size_t position = scan(sig, current.data, current.size, offset, current.scanSize);
+      if (position == NO_MATCH) break;
+
+      addresses.push_back(current.address + position);
+      offset = position + 1;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (chunks.size() <= current.index) chunks.resize(current.index + 1);
+    chunks[current.index] = { true, current.range, std::move(addresses) };
+
+    for (; !found && frontier < chunks.size() && chunks[frontier].done; frontier++) {
+      if (chunks[frontier].range != frontierRange) {
+        frontierRange = chunks[frontier].range;
+        skipIndex = 0;
+      }
+
+      for (uintptr_t address : chunks[frontier].addresses) {
+        if (skipIndex++ >= skip) {
+          found = true;
+          match = address;
+          break;
+        }
+      }
+    }
+
+    return !found;
+  }, cancelled);
+
+  if (found && (cancelled == NULL || !cancelled->load())) return match;
 
   // the method that calls this will check to see if the value is -2
 	// and throw a 'no match' error
   return -2;
-};
+}
+
+uintptr_t pattern::resolveMatch(pid_t hProcess, uintptr_t address, uintptr_t baseAddress, short sigType, uintptr_t patternOffset, uintptr_t addressOffset) {
+  memory Memory;
+  address += patternOffset;
+
+  /* read memory at pattern if flag is raised*/
+  if (sigType & ST_READ) Memory.readMemoryData(hProcess, address, &address, sizeof(uintptr_t));
+
+  /* subtract image base if flag is raised */
+  if (sigType & ST_SUBTRACT) address -= baseAddress;
+
+  return address + addressOffset;
+}
+
+void pattern::findPatterns(pid_t hProcess, module::Module module, uintptr_t baseAddress, const std::vector<request>& requests, std::vector<uintptr_t>& results, const std::atomic<bool>* cancelled) {
+  std::vector<scanner::range> ranges = { { module.start, module.end } };
+  std::vector<uintptr_t> matches(requests.size(), (uintptr_t)-2);
+  findMatchesInRanges(hProcess, ranges, requests, matches, cancelled);
+
+  for (size_t i = 0; i < requests.size(); i++) {
+    if (matches[i] == (uintptr_t)-2) continue;
+    results[i] = resolveMatch(hProcess, matches[i], baseAddress, requests[i].sigType, requests[i].patternOffset, requests[i].addressOffset);
+  }
+}
+
+void pattern::findMatchesInRanges(pid_t hProcess, const std::vector<scanner::range>& ranges, const std::vector<request>& requests, std::vector<uintptr_t>& matches, const std::atomic<bool>* cancelled) {
+  // Dispatch table from anchor byte value to the requests anchored on it, laid out
+  // as one array of entries indexed by per-byte start offsets
+  struct anchorEntry {
+    uint32_t request;
+    uint32_t anchor;
+  };
+
+  std::vector<uint32_t> bucketStart(257, 0);
+  std::vector<anchorEntry> entries;
+  size_t overlap = 0;
+  size_t remaining = 0;
+
+  // Raised once a request's match is final; lets chunks still being scanned skip it
+  std::unique_ptr<std::atomic<bool>[]> resolved(new std::atomic<bool>[requests.size()]);
+
+  for (size_t i = 0; i < requests.size(); i++) {
+    const signature& sig = requests[i].sig;
+    resolved[i] = true;
+
+    // Wildcard-only signatures match at the start of the first range that is long enough
+    if (sig.fixedCount == 0) {
+      for (const scanner::range& range : ranges) {
+        if (requests[i].skip + sig.bytes.size() <= range.end - range.start) {
+          matches[i] = range.start + requests[i].skip;
+          break;
+        }
+      }
+      continue;
+    }
+
+    resolved[i] = false;
+    remaining++;
+    bucketStart[sig.bytes[sig.anchors[0]] + 1]++;
+    if (sig.bytes.size() - 1 > overlap) overlap = sig.bytes.size() - 1;
+  }
+
+  if (remaining == 0) return;
+
+  for (size_t b = 1; b < bucketStart.size(); b++) {
+    bucketStart[b] += bucketStart[b - 1];
+  }
+
+  entries.resize(remaining);
+  std::vector<uint32_t> fill(bucketStart.begin(), bucketStart.end() - 1);
+  for (size_t i = 0; i < requests.size(); i++) {
+    if (resolved[i]) continue;
+
+    const signature& sig = requests[i].sig;
+    entries[fill[sig.bytes[sig.anchors[0]]]++] = { (uint32_t)i, (uint32_t)sig.anchors[0] };
+  }
+
+  struct chunkMatches {
+    bool done;
+    size_t range;
+    // (request, address) in address order per request
+    std::vector<std::pair<uint32_t, uintptr_t>> matches;
+  };
+
+  // As in findMatchInRanges, matches are only counted once every earlier chunk has finished
+  std::mutex mutex;
+  std::vector<chunkMatches> chunks;
+  std::vector<uint32_t> matchCount(requests.size(), 0);
+  size_t frontier = 0;
+  size_t frontierRange = (size_t)-1;
+
+  scanner::forEachChunk(hProcess, ranges, overlap, [&](const scanner::chunk& current) {
+    std::vector<std::pair<uint32_t, uintptr_t>> found;
+    std::vector<uint32_t> chunkCount(requests.size(), 0);
+    const unsigned char* data = current.data;
+
+    // One pass over the chunk; every position is looked up once in the dispatch table.
+    // Each request's candidates come in increasing order, so `skip` keeps its meaning.
+    for (size_t position = 0; position < current.size; position++) {
+      const unsigned char value = data[position];
+      for (uint32_t e = bucketStart[value]; e < bucketStart[value + 1]; e++) {
+        const anchorEntry& entry = entries[e];
+        if (position < entry.anchor || position - entry.anchor >= current.scanSize) continue;
+
+        // No range needs more than skip + 1 matches, so neither does any chunk
+        const request& candidateRequest = requests[entry.request];
+        if (chunkCount[entry.request] > candidateRequest.skip || resolved[entry.request].load(std::memory_order_relaxed)) continue;
+
+        size_t candidate = position - entry.anchor;
+        if (candidate + candidateRequest.sig.bytes.size() > current.size || !matchesAt(candidateRequest.sig, data + candidate)) continue;
+
+        chunkCount[entry.request]++;
+        found.push_back({ entry.request, current.address + candidate });
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (chunks.size() <= current.index) chunks.resize(current.index + 1);
+    chunks[current.index] = { true, current.range, std::move(found) };
+
+    for (; remaining > 0 && frontier < chunks.size() && chunks[frontier].done; frontier++) {
+      // Like scanning each mapping on its own, skip counts start over in every range
+      if (chunks[frontier].range != frontierRange) {
+        frontierRange = chunks[frontier].range;
+        std::fill(matchCount.begin(), matchCount.end(), 0);
+      }
+
+      for (const std::pair<uint32_t, uintptr_t>& match : chunks[frontier].matches) {
+        if (resolved[match.first]) continue;
+
+        if (matchCount[match.first]++ >= requests[match.first].skip) {
+          matches[match.first] = match.second;
+          resolved[match.first] = true;
+          remaining--;
+        }
+      }
+      chunks[frontier].matches.clear();
+    }
+
+    return remaining > 0;
+  }, cancelled);
+
+  if (cancelled != NULL && cancelled->load()) matches.assign(requests.size(), (uintptr_t)-2);
+}
+
+bool pattern::findPatternsInModule(pid_t hProcess, const char* moduleName, const std::vector<request>& requests, std::vector<uintptr_t>& results, const char** errorMessage, const std::atomic<bool>* cancelled) {
+  results.assign(requests.size(), (uintptr_t)-2);
+
+  module::Region first;
+  std::string firstPath;
+  std::vector<scanner::range> ranges = moduleRanges(hProcess, moduleName, errorMessage, &first, &firstPath);
+
+  if (ranges.empty()) return false;
 
-bool pattern::compareBytes(const unsigned char* bytes, const char* pattern) {
-  for (; *pattern; *pattern != ' ' ? ++bytes : bytes, ++pattern) {
-    if (*pattern == ' ' || *pattern == '?')
+  // The first mapping of the module is its base
+  const uintptr_t baseAddress = ranges[0].start;
+
+  signatureCache::identity identity;
+  const bool useCache = signatureCache::enabled() && signatureCache::identify(hProcess, first, firstPath, ranges, &identity);
+
+  // Requests with a cached offset that still matches are resolved without scanning
+  std::vector<request> pending;
+  std::vector<size_t> pendingIndex;
+  std::vector<uintptr_t> matches(requests.size(), (uintptr_t)-2);
+
+  for (size_t i = 0; i < requests.size(); i++) {
+    uintptr_t offset;
+    if (useCache && signatureCache::lookup(identity, requests[i].sig, requests[i].skip, &offset) && verifyMatch(hProcess, ranges, requests[i].sig, baseAddress + offset)) {
+      matches[i] = baseAddress + offset;
       continue;
-		
-    if (*bytes != getByte(pattern))
-      return false;
-    
-    ++pattern;
+    }
+
+    pending.push_back(requests[i]);
+    pendingIndex.push_back(i);
+  }
+
+  if (!pending.empty()) {
+    std::vector<uintptr_t> found(pending.size(), (uintptr_t)-2);
+    findMatchesInRanges(hProcess, ranges, pending, found, cancelled);
+
+    for (size_t i = 0; i < pending.size(); i++) {
+      if (found[i] == (uintptr_t)-2) continue;
+
+      matches[pendingIndex[i]] = found[i];
+      if (useCache) signatureCache::store(identity, pending[i].sig, pending[i].skip, found[i] - baseAddress);
+    }
   }
-  
+
+  if (cancelled != NULL && cancelled->load()) return true;
+
+  for (size_t i = 0; i < requests.size(); i++) {
+    if (matches[i] == (uintptr_t)-2) continue;
+    results[i] = resolveMatch(hProcess, matches[i], baseAddress, requests[i].sigType, requests[i].patternOffset, requests[i].addressOffset);
+  }
+
   return true;
 }
+
+uintptr_t pattern::findPatternInModule(pid_t hProcess, const char* moduleName, const char* pattern, short sigType, uintptr_t patternOffset, uintptr_t addressOffset, uint32_t skip, const char** errorMessage, const std::atomic<bool>* cancelled) {
+  signature sig;
+  if (!compileSignature(pattern, &sig)) {
+    *errorMessage = "invalid signature";
+    return -2;
+  }
+
+  module::Region first;
+  std::string firstPath;
+  std::vector<scanner::range> ranges = moduleRanges(hProcess, moduleName, errorMessage, &first, &firstPath);
+
+  if (ranges.empty()) return -1;
+
+  // The first mapping of the module is its base
+  const uintptr_t baseAddress = ranges[0].start;
+
+  signatureCache::identity identity;
+  const bool useCache = signatureCache::enabled() && signatureCache::identify(hProcess, first, firstPath, ranges, &identity);
+
+  // A cached offset only costs a read of the signature's length to confirm
+  uintptr_t offset;
+  uintptr_t match = -2;
+  if (useCache && signatureCache::lookup(identity, sig, skip, &offset) && verifyMatch(hProcess, ranges, sig, baseAddress + offset)) {
+    match = baseAddress + offset;
+  } else {
+    match = findMatchInRanges(hProcess, ranges, sig, skip, cancelled);
+    if (useCache && match != (uintptr_t)-2) signatureCache::store(identity, sig, skip, match - baseAddress);
+  }
+
+  // the method that calls this will check to see if the value is -2
+  // and throw a 'no match' error
+  if (match == (uintptr_t)-2) return -2;
+
+  return resolveMatch(hProcess, match, baseAddress, sigType, patternOffset, addressOffset);
+}
+
+bool pattern::findPatternAllInModule(pid_t hProcess, const char* moduleName, const char* pattern, short sigType, uintptr_t patternOffset, uintptr_t addressOffset, size_t limit, std::vector<uintptr_t>& results, const char** errorMessage, const std::atomic<bool>* cancelled) {
+  results.clear();
+
+  signature sig;
+  if (!compileSignature(pattern, &sig)) {
+    *errorMessage = "invalid signature";
+    return true;
+  }
+
+  std::vector<scanner::range> ranges = moduleRanges(hProcess, moduleName, errorMessage);
+  if (ranges.empty()) return false;
+
+  struct chunkMatches {
+    bool done;
+    std::vector<uintptr_t> addresses;
+  };
+
+  // Same frontier as findMatchInRanges, so the matches come out in address order and
+  // scanning stops once `limit` of them are known
+  std::mutex mutex;
+  std::vector<chunkMatches> chunks;
+  size_t frontier = 0;
+
+  scanner::forEachChunk(hProcess, ranges, sig.bytes.size() - 1, [&](const scanner::chunk& current) {
+    std::vector<uintptr_t> addresses;
+    for (size_t offset = 0; limit == 0 || addresses.size() < limit;) {
+      size_t position = scan(sig, current.data, current.size, offset, current.scanSize);
+      if (position == NO_MATCH) break;
+
+      addresses.push_back(current.address + position);
+      offset = position + 1;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (chunks.size() <= current.index) chunks.resize(current.index + 1);
+    chunks[current.index] = { true, std::move(addresses) };
+
+    for (; frontier < chunks.size() && chunks[frontier].done; frontier++) {
+      std::vector<uintptr_t>& matches = chunks[frontier].addresses;
+      size_t count = limit == 0 || results.size() + matches.size() <= limit ? matches.size() : limit - results.size();
+      results.insert(results.end(), matches.begin(), matches.begin() + count);
+      std::vector<uintptr_t>().swap(matches);
+    }
+
+    return limit == 0 || results.size() < limit;
+  }, cancelled);
+
+  if (cancelled != NULL && cancelled->load()) {
+    results.clear();
+    return true;
+  }
+
+  // The first mapping of the module is its base
+  resolveMatches(hProcess, results, ranges[0].start, sigType, patternOffset, addressOffset);
+  return true;
+}
+
+void pattern::resolveMatches(pid_t hProcess, std::vector<uintptr_t>& addresses, uintptr_t baseAddress, short sigType, uintptr_t patternOffset, uintptr_t addressOffset) {
+  for (uintptr_t& address : addresses) {
+    address += patternOffset;
+  }
+
+  /* read every pointer in place with one batched read if flag is raised */
+  if (sigType & ST_READ) {
+    std::vector<memory::batchEntry> entries(addresses.size());
+    for (size_t i = 0; i < addresses.size(); i++) {
+      entries[i] = { addresses[i], &addresses[i], sizeof(uintptr_t), false };
+    }
+
+    memory Memory;
+    Memory.readMemoryBatch(hProcess, entries.data(), entries.size());
+
+    // Like readMemoryData in resolveMatch, an unreadable pointer reads as 0
+    for (size_t i = 0; i < entries.size(); i++) {
+      if (!entries[i].ok) addresses[i] = 0;
+    }
+  }
+
+  for (uintptr_t& address : addresses) {
+    /* subtract image base if flag is raised */
+    if (sigType & ST_SUBTRACT) address -= baseAddress;
+
+    address += addressOffset;
+  }
+}
+
+std::vector<scanner::range> pattern::moduleRanges(pid_t hProcess, const char* moduleName, const char** errorMessage, module::Region* first, std::string* firstPath) {
+  std::shared_ptr<const module::RegionTable> table;
+  std::vector<module::Region> moduleEntries = module::getModules(hProcess, errorMessage, &table);
+
+  std::vector<scanner::range> ranges;
+  for (std::vector<module::Region>::size_type i = 0; i != moduleEntries.size(); i++) {
+    const char* pathname = module::modulePath(*table, moduleEntries[i]);
+    if (strstr(pathname, moduleName) != NULL) {
+      if (ranges.empty() && first != NULL) {
+        *first = moduleEntries[i];
+        *firstPath = pathname;
+      }
+      ranges.push_back({ moduleEntries[i].start, moduleEntries[i].end });
+    }
+  }
+
+  return ranges;
+}
+
+bool pattern::verifyMatch(pid_t hProcess, const std::vector<scanner::range>& ranges, const signature& sig, uintptr_t address) {
+  // The whole signature has to lie within one of the module's mappings
+  bool inside = false;
+  for (const scanner::range& range : ranges) {
+    if (address >= range.start && address <= range.end && sig.bytes.size() <= range.end - address) inside = true;
+  }
+  if (!inside) return false;
+
+  memory Memory;
+  std::vector<unsigned char> data(sig.bytes.size());
+  if (Memory.readMemoryPartial(hProcess, address, data.data(), data.size(), NULL) != data.size()) return false;
+
+  return matchesAt(sig, data.data());
+}
@@ -3,7 +3,11 @@
 #define PATTERN_H
 
 #include <node.h>
+#include <atomic>
+#include <vector>
+#include <string>
 #include "module.h"
+#include "scanner.h"
 
 class pattern {
 public:
@@ -20,9 +24,74 @@ public:
     ST_SUBTRACT = 0x2
   };
 
-  uintptr_t findPattern(pid_t hProcess, module::Module module, uintptr_t baseAddress, const char* pattern, short sigType, uintptr_t patternOffset, uintptr_t addressOffset, uint32_t skip);
-  bool compareBytes(const unsigned char* bytes, const char* pattern);
+  // Returned by scan when there is no match
+  static const size_t NO_MATCH = (size_t)-1;
+
+  // A signature compiled once from its hex string ("8B 0D ? ? ? ? 5F").
+  // Wildcard positions hold 0 in both `bytes` and `mask`.
+  struct signature {
+    std::vector<unsigned char> bytes;
+    std::vector<unsigned char> mask;
+    // Positions of the two least common fixed bytes, used to find candidates
+    size_t anchors[2];
+    size_t fixedCount;
+  };
+
+  // One signature of a multi-signature scan, with the same options as findPattern
+  struct request {
+    signature sig;
+    short sigType;
+    uintptr_t patternOffset;
+    uintptr_t addressOffset;
+    uint32_t skip;
+  };
+
+  static bool compileSignature(const char* pattern, signature* result);
+
+  // Returns the first offset in [from, to) where `sig` matches `data`, or NO_MATCH.
+  // Only matches that lie entirely within `size` bytes are reported.
+  static size_t scan(const signature& sig, const unsigned char* data, size_t size, size_t from, size_t to);
+
+  // `cancelled` is polled while scanning; once it is raised the scan gives up and reports no match.
+  uintptr_t findPattern(pid_t hProcess, module::Module module, uintptr_t baseAddress, const char* pattern, short sigType, uintptr_t patternOffset, uintptr_t addressOffset, uint32_t skip, const std::atomic<bool>* cancelled = NULL);
+  uintptr_t findPattern(pid_t hProcess, module::Module module, uintptr_t baseAddress, const signature& sig, short sigType, uintptr_t patternOffset, uintptr_t addressOffset, uint32_t skip, const std::atomic<bool>* cancelled = NULL);
+
+  // Matches every request in a single pass over the mapping. results[i] is set
+  // for each request that matches and left untouched otherwise.
+  void findPatterns(pid_t hProcess, module::Module module, uintptr_t baseAddress, const std::vector<request>& requests, std::vector<uintptr_t>& results, const std::atomic<bool>* cancelled = NULL);
+
+  // findPatterns over every mapping whose path contains `moduleName` (the first one being the module
+  // base). results[i] is -2 for requests that did not match. Returns false if no mapping matched the name.
+  bool findPatternsInModule(pid_t hProcess, const char* moduleName, const std::vector<request>& requests, std::vector<uintptr_t>& results, const char** errorMessage, const std::atomic<bool>* cancelled = NULL);
+
+  // Scans every mapping whose path contains `moduleName` until one matches. The first such
+  // mapping is the module base. Returns -1 if no mapping matched the name, -2 if there was no match.
+  uintptr_t findPatternInModule(pid_t hProcess, const char* moduleName, const char* pattern, short sigType, uintptr_t patternOffset, uintptr_t addressOffset, uint32_t skip, const char** errorMessage, const std::atomic<bool>* cancelled = NULL);
+
+  // Every match in the mappings whose path contains `moduleName`, in address order and with the flags
+  // and offsets applied, stopping after `limit` matches (0 for all). Returns false if no mapping matched the name.
+  bool findPatternAllInModule(pid_t hProcess, const char* moduleName, const char* pattern, short sigType, uintptr_t patternOffset, uintptr_t addressOffset, size_t limit, std::vector<uintptr_t>& results, const char** errorMessage, const std::atomic<bool>* cancelled = NULL);
+
+private:
+  // Address ranges of every mapping whose path contains `moduleName`, in address order. `first`
+  // and `firstPath` receive the first of those mappings and its path.
+  static std::vector<scanner::range> moduleRanges(pid_t hProcess, const char* moduleName, const char** errorMessage, module::Region* first = NULL, std::string* firstPath = NULL);
+
+  // Scans the ranges in parallel; like calling findPattern on each range in turn, `skip`
+  // counts matches within a range and the first range with a match wins. Returns the address
+  // of the match itself (no flags or offsets applied), or -2 if no range matched.
+  uintptr_t findMatchInRanges(pid_t hProcess, const std::vector<scanner::range>& ranges, const signature& sig, uint32_t skip, const std::atomic<bool>* cancelled);
+
+  // Multi-signature counterpart of findMatchInRanges; matches[i] is left at -2 for requests that do not match.
+  void findMatchesInRanges(pid_t hProcess, const std::vector<scanner::range>& ranges, const std::vector<request>& requests, std::vector<uintptr_t>& matches, const std::atomic<bool>* cancelled);
+
+  // Whether `sig` still matches at `address`, which must lie within `ranges`. Used to confirm cached offsets.
+  static bool verifyMatch(pid_t hProcess, const std::vector<scanner::range>& ranges, const signature& sig, uintptr_t address);
+
+  // Applies the ST_READ/ST_SUBTRACT flags and offsets to a match at `address`
+  uintptr_t resolveMatch(pid_t hProcess, uintptr_t address, uintptr_t baseAddress, short sigType, uintptr_t patternOffset, uintptr_t addressOffset);
+  // resolveMatch for many matches, ST_READ reads every pointer with one batched read
+  void resolveMatches(pid_t hProcess, std::vector<uintptr_t>& addresses, uintptr_t baseAddress, short sigType, uintptr_t patternOffset, uintptr_t addressOffset);
 };
 
 #endif
-#pragma once
@@ -0,0 +1,391 @@
+#include <node.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdio>
+#include <cstring>
+#include "pointerscanner.h"
+#include "module.h"
+#include "scanner.h"
+#include "memory.h"
+
+namespace {
+  const char fileMagic[8] = { 'M', 'J', 'S', 'P', 'T', 'R', 'M', 'P' };
+  const uint32_t fileVersion = 1;
+
+  bool byTarget(const pointerScanner::entry& a, const pointerScanner::entry& b) {
+    return a.target != b.target ? a.target < b.target : a.address < b.address;
+  }
+
+  // Device mappings are left out, reading them can have side effects
+  bool isDevice(const char* pathname) {
+    return !strncmp(pathname, "/dev/", 5) && strncmp(pathname, "/dev/shm/", 9) && strncmp(pathname, "/dev/zero", 9);
+  }
+
+  void addRange(std::vector<scanner::range>& ranges, uintptr_t start, uintptr_t end) {
+    if (!ranges.empty() && ranges.back().end == start) {
+      ranges.back().end = end;
+    } else {
+      ranges.push_back({ start, end });
+    }
+  }
+
+  // Collects the pointers of one chunk, sorted
+  template <typename Pointer>
+  void scanChunk(const scanner::chunk& current, const std::vector<scanner::range>& targets, std::vector<pointerScanner::entry>& found) {
+    const size_t page = memory::pageSize();
+    const uintptr_t firstPage = current.address & ~(uintptr_t)(page - 1);
+    const uint64_t lowest = targets.front().start;
+    const uint64_t highest = targets.back().end;
+
+    // Pointers cluster, so the range of the previous hit is tried before searching
+    const scanner::range* last = &targets.front();
+
+    for (size_t offset = 0; offset < current.scanSize;) {
+      const size_t index = (current.address + offset - firstPage) / page;
+      const size_t pageEnd = std::min(current.scanSize, (index + 1) * page + firstPage - current.address);
+      if (!((current.validPages[index / 8] >> (index % 8)) & 1)) {
+        offset = pageEnd;
+        continue;
+      }
+
+      for (size_t at = (offset + sizeof(Pointer) - 1) & ~(sizeof(Pointer) - 1); at + sizeof(Pointer) <= pageEnd; at += sizeof(Pointer)) {
+        Pointer value;
+        memcpy(&value, current.data + at, sizeof(Pointer));
+        if (__builtin_expect(value < lowest || value >= highest, 1)) continue;
+
+        if (value < last->start || value >= last->end) {
+          const scanner::range* next = std::upper_bound(targets.data(), targets.data() + targets.size(), (uint64_t)value, [](uint64_t target, const scanner::range& candidate) {
+            return target < candidate.start;
+          });
+          if (next == targets.data() || value >= (next - 1)->end) continue;
+          last = next - 1;
+        }
+
+        found.push_back({ (uint64_t)value, (uint64_t)(current.address + at) });
+      }
+
+      offset = pageEnd;
+    }
+
+    std::sort(found.begin(), found.end(), byTarget);
+  }
+
+  // Merges sorted runs, pairs of runs at a time on separate threads
+  void mergeRuns(std::vector<pointerScanner::entry>& entries, std::vector<size_t> bounds) {
+    if (bounds.size() <= 2) return;
+    std::vector<pointerScanner::entry> other(entries.size());
+
+    while (bounds.size() > 2) {
+      std::vector<size_t> merged(1, 0);
+      std::vector<std::thread> workers;
+      const size_t threads = scanner::threadCount();
+
+      for (size_t i = 0; i + 1 < bounds.size(); i += 2) {
+        const size_t from = bounds[i];
+        const size_t middle = bounds[i + 1];
+        const size_t to = i + 2 < bounds.size() ? bounds[i + 2] : middle;
+
+        workers.emplace_back([&entries, &other, from, middle, to]() {
+          std::merge(entries.begin() + from, entries.begin() + middle, entries.begin() + middle, entries.begin() + to, other.begin() + from, byTarget);
+        });
+        merged.push_back(to);
+
+        if (workers.size() == threads) {
+          for (std::thread& worker : workers) worker.join();
+          workers.clear();
+        }
+      }
+
+      for (std::thread& worker : workers) worker.join();
+      entries.swap(other);
+      bounds.swap(merged);
+    }
+  }
+
+  struct pathSearch {
+    const pointerScanner::pointerMap& map;
+    const pointerScanner::searchOptions& options;
+    std::vector<pointerScanner::path>& results;
+    const std::atomic<bool>* cancelled;
+    // Offsets from the address back towards the module, reversed when a path is found
+    std::vector<uint64_t> offsets;
+    // Addresses from which no module can be reached with that many pointers or fewer
+    std::unordered_map<uint64_t, size_t> deadEnds;
+
+    const pointerScanner::staticRange* findStatic(uint64_t address) const {
+      auto next = std::upper_bound(map.statics.begin(), map.statics.end(), address, [](uint64_t value, const pointerScanner::staticRange& range) {
+        return value < range.start;
+      });
+      if (next == map.statics.begin() || address >= (next - 1)->end) return NULL;
+      return &*(next - 1);
+    }
+
+    // Looks for paths of exactly `remaining` more pointers to `address`. Returns whether a
+    // module is reachable with `remaining` pointers or fewer, found or not.
+    bool search(uint64_t address, size_t remaining) {
+      auto deadEnd = deadEnds.find(address);
+      if (deadEnd != deadEnds.end() && deadEnd->second >= remaining) return false;
+
+      const uint64_t lowest = address > options.maxOffset ? address - options.maxOffset : 0;
+      auto first = std::lower_bound(map.entries.begin(), map.entries.end(), lowest, [](const pointerScanner::entry& e, uint64_t value) {
+        return e.target < value;
+      });
+      auto last = std::upper_bound(first, map.entries.end(), address, [](uint64_t value, const pointerScanner::entry& e) {
+        return value < e.target;
+      });
+
+      bool reachable = false;
+
+      // Closest pointers first, they give the smallest offsets
+      for (auto it = last; it != first && results.size() < options.maxResults;) {
+        if (cancelled != NULL && cancelled->load()) return reachable;
+        --it;
+        offsets.push_back(address - it->target);
+
+        const pointerScanner::staticRange* found = findStatic(it->address);
+        if (found != NULL) {
+          reachable = true;
+          if (remaining == 1) {
+            pointerScanner::path result;
+            result.module = found->module;
+            result.offsets.push_back(it->address - map.moduleBases[found->module]);
+            result.offsets.insert(result.offsets.end(), offsets.rbegin(), offsets.rend());
+            results.push_back(std::move(result));
+          }
+        } else if (remaining > 1) {
+          reachable = search(it->address, remaining - 1) || reachable;
+        }
+
+        offsets.pop_back();
+      }
+
+      if (!reachable && results.size() < options.maxResults) {
+        size_t& known = deadEnds[address];
+        if (known < remaining) known = remaining;
+      }
+      return reachable;
+    }
+  };
+
+  template <typename T>
+  bool writeValue(FILE* file, const T& value) {
+    return fwrite(&value, sizeof(value), 1, file) == 1;
+  }
+
+  template <typename T>
+  bool readValue(FILE* file, T* value) {
+    return fread(value, sizeof(*value), 1, file) == 1;
+  }
+}
+
+bool pointerScanner::buildMap(pid_t hProcess, size_t pointerSize, pointerMap* result, const char** errorMessage, const std::atomic<bool>* cancelled) {
+  std::shared_ptr<const module::RegionTable> table = module::getRegionMap(hProcess, errorMessage);
+  if (strcmp(*errorMessage, "")) {
+    return false;
+  }
+
+  result->pointerSize = pointerSize;
+  result->entries.clear();
+  result->modules.clear();
+  result->moduleBases.clear();
+  result->statics.clear();
+
+  // Pointers may point anywhere readable, they are only looked for outside of code
+  std::vector<scanner::range> targets;
+  std::vector<scanner::range> scanned;
+  std::unordered_map<uint32_t, uint32_t> moduleIndex;
+  const module::Region* previous = NULL;
+  uint32_t previousModule = 0;
+
+  for (const module::Region& region : table->regions) {
+    const char* pathname = table->pathname(region);
+    if (!(region.permissions & module::P_READ) || isDevice(pathname)) {
+      previous = NULL;
+      continue;
+    }
+
+    addRange(targets, region.start, region.end);
+    if (!(region.permissions & module::P_EXECUTE)) addRange(scanned, region.start, region.end);
+
+    // File mappings belong to their module, and so does an anonymous mapping right after
+    // one (its .bss)
+    bool fileBacked = region.inode != 0 && strchr(pathname, '/') != NULL;
+    bool bss = !fileBacked && pathname[0] == '\0' && previous != NULL && previous->end == region.start;
+
+    if (fileBacked) {
+      auto known = moduleIndex.find(region.path);
+      if (known == moduleIndex.end()) {
+        const char* name = strrchr(pathname, '/') + 1;
+        known = moduleIndex.emplace(region.path, (uint32_t)result->modules.size()).first;
+        result->modules.push_back(name);
+        result->moduleBases.push_back(region.start);
+      }
+      previousModule = known->second;
+    }
+
+    if (fileBacked || bss) {
+      if (!result->statics.empty() && result->statics.back().end == region.start && result->statics.back().module == previousModule) {
+        result->statics.back().end = region.end;
+      } else {
+        result->statics.push_back({ region.start, region.end, previousModule });
+      }
+    }
+
+    previous = fileBacked ? &region : NULL;
+  }
+
+  if (targets.empty() || scanned.empty()) {
+    return true;
+  }
+
+  struct chunkEntries {
+    bool done;
+    std::vector<entry> entries;
+  };
+
+  std::mutex mutex;
+  std::vector<chunkEntries> chunks;
+
+  scanner::forEachChunk(hProcess, scanned, 0, [&](const scanner::chunk& current) {
+    std::vector<entry> found;
+    if (pointerSize == 4) {
+      scanChunk<uint32_t>(current, targets, found);
+    } else {
+      scanChunk<uint64_t>(current, targets, found);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (chunks.size() <= current.index) chunks.resize(current.index + 1);
+    chunks[current.index].done = true;
+    chunks[current.index].entries = std::move(found);
+    return true;
+  }, cancelled);
+
+  if (cancelled != NULL && cancelled->load()) {
+    return true;
+  }
+
+  // Every chunk is sorted already, only the runs are left to merge
+  size_t total = 0;
+  for (const chunkEntries& chunk : chunks) total += chunk.entries.size();
+
+  std::vector<size_t> bounds(1, 0);
+  result->entries.reserve(total);
+  for (chunkEntries& chunk : chunks) {
+    if (chunk.entries.empty()) continue;
+    result->entries.insert(result->entries.end(), chunk.entries.begin(), chunk.entries.end());
+    bounds.push_back(result->entries.size());
+    std::vector<entry>().swap(chunk.entries);
+  }
+
+  mergeRuns(result->entries, bounds);
+  return true;
+}
+
+void pointerScanner::findPaths(const pointerMap& map, uint64_t address, const searchOptions& options, std::vector<path>& results, const std::atomic<bool>* cancelled) {
+  pathSearch search = { map, options, results, cancelled, {}, {} };
+  const size_t maxDepth = options.maxDepth < maxSearchDepth ? options.maxDepth : maxSearchDepth;
+
+  // Shorter paths first: each pass only keeps paths of exactly `depth` pointers, while the
+  // dead ends found stay valid for the longer passes
+  for (size_t depth = 1; depth <= maxDepth && results.size() < options.maxResults; depth++) {
+    if (cancelled != NULL && cancelled->load()) return;
+    search.search(address, depth);
+  }
+}
+
+bool pointerScanner::save(const pointerMap& map, const char* filename, const char** errorMessage) {
+  FILE* file = fopen(filename, "wb");
+  if (file == NULL) {
+    *errorMessage = "cannot write pointer map";
+    return false;
+  }
+
+  bool ok = fwrite(fileMagic, sizeof(fileMagic), 1, file) == 1
+    && writeValue(file, fileVersion)
+    && writeValue(file, (uint32_t)map.pointerSize)
+    && writeValue(file, (uint64_t)map.modules.size());
+
+  for (size_t i = 0; ok && i < map.modules.size(); i++) {
+    ok = writeValue(file, map.moduleBases[i])
+      && writeValue(file, (uint32_t)map.modules[i].size())
+      && fwrite(map.modules[i].data(), 1, map.modules[i].size(), file) == map.modules[i].size();
+  }
+
+  ok = ok && writeValue(file, (uint64_t)map.statics.size());
+  for (size_t i = 0; ok && i < map.statics.size(); i++) {
+    ok = writeValue(file, map.statics[i].start) && writeValue(file, map.statics[i].end) && writeValue(file, map.statics[i].module);
+  }
+
+  ok = ok && writeValue(file, (uint64_t)map.entries.size());
+  ok = ok && fwrite(map.entries.data(), sizeof(entry), map.entries.size(), file) == map.entries.size();
+
+  if (fclose(file) != 0) ok = false;
+  if (!ok) {
+    *errorMessage = "cannot write pointer map";
+  }
+  return ok;
+}
+
+bool pointerScanner::load(const char* filename, pointerMap* result, const char** errorMessage) {
+  FILE* file = fopen(filename, "rb");
+  if (file == NULL) {
+    *errorMessage = "cannot open pointer map";
+    return false;
+  }
+
+  char magic[sizeof(fileMagic)];
+  uint32_t version = 0;
+  uint32_t pointerSize = 0;
+  uint64_t count = 0;
+
+  bool ok = fread(magic, sizeof(magic), 1, file) == 1 && !memcmp(magic, fileMagic, sizeof(magic))
+    && readValue(file, &version) && version == fileVersion
+    && readValue(file, &pointerSize) && (pointerSize == 4 || pointerSize == 8)
+    && readValue(file, &count);
+
+  result->pointerSize = pointerSize;
+  result->modules.clear();
+  result->moduleBases.clear();
+  result->statics.clear();
+  result->entries.clear();
+
+  for (uint64_t i = 0; ok && i < count; i++) {
+    uint64_t base;
+    uint32_t length;
+    ok = readValue(file, &base) && readValue(file, &length) && length <= 4096;
+    if (!ok) break;
+
+    std::string name(length, '\0');
+    ok = fread(&name[0], 1, length, file) == length;
+    result->moduleBases.push_back(base);
+    result->modules.push_back(name);
+  }
+
+  ok = ok && readValue(file, &count);
+  for (uint64_t i = 0; ok && i < count; i++) {
+    staticRange range;
+    ok = readValue(file, &range.start) && readValue(file, &range.end) && readValue(file, &range.module) && range.module < result->modules.size();
+    result->statics.push_back(range);
+  }
+
+  ok = ok && readValue(file, &count);
+  if (ok) {
+    // Grown as it is read, so a damaged count fails at the end of the file instead of allocating it
+    const size_t step = 1 << 20;
+    for (uint64_t read = 0; ok && read < count; read += step) {
+      size_t entries = (size_t)std::min<uint64_t>(step, count - read);
+      result->entries.resize(read + entries);
+      ok = fread(result->entries.data() + read, sizeof(entry), entries, file) == entries;
+    }
+  }
+
+  fclose(file);
+  if (!ok) {
+    *errorMessage = "not a valid pointer map file";
+  }
+  return ok;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#ifndef POINTERSCANNER_H
+#define POINTERSCANNER_H
+
+#include <node.h>
+#include <unistd.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <atomic>
+
+// Finds pointer paths from the static data of a process's modules to a dynamic address.
+// A reverse pointer map of the process is built once; paths to any address are then found
+// by walking it backwards from the address, and can be kept across runs by saving the map.
+class pointerScanner {
+public:
+  // An aligned pointer-sized value `target` stored at `address`
+  struct entry {
+    uint64_t target;
+    uint64_t address;
+  };
+
+  // Memory mapped from a module's file (and its .bss), where pointers survive restarts
+  struct staticRange {
+    uint64_t start;
+    uint64_t end;
+    uint32_t module;
+  };
+
+  struct pointerMap {
+    size_t pointerSize;
+    // Every pointer into readable memory, sorted by target and then by address
+    std::vector<entry> entries;
+    // File names of the modules and where they were loaded in the mapped process
+    std::vector<std::string> modules;
+    std::vector<uint64_t> moduleBases;
+    // Sorted by start
+    std::vector<staticRange> statics;
+  };
+
+  // `module` + offsets[0] holds a pointer, every later offset is added to the pointer read
+  // before it, and the last one yields the address. The same form readPointerChain takes.
+  struct path {
+    uint32_t module;
+    std::vector<uint64_t> offsets;
+  };
+
+  // Each pointer of a path multiplies the search, deeper searches are refused
+  static const size_t maxSearchDepth = 16;
+
+  struct searchOptions {
+    // Pointers followed from the module to the address, at most maxSearchDepth
+    size_t maxDepth;
+    // Largest offset added to a pointer
+    uint64_t maxOffset;
+    size_t maxResults;
+  };
+
+  // Reads every readable, non-executable mapping of the process on all scan threads and
+  // keeps the aligned values of `pointerSize` bytes (4 or 8) that point into readable memory.
+  static bool buildMap(pid_t hProcess, size_t pointerSize, pointerMap* result, const char** errorMessage, const std::atomic<bool>* cancelled = NULL);
+
+  // Appends the paths to `address`, shortest first within each branch. A cancelled search
+  // keeps the paths found so far.
+  static void findPaths(const pointerMap& map, uint64_t address, const searchOptions& options, std::vector<path>& results, const std::atomic<bool>* cancelled = NULL);
+
+  static bool save(const pointerMap& map, const char* filename, const char** errorMessage);
+  static bool load(const char* filename, pointerMap* result, const char** errorMessage);
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include <node.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "scanner.h"
+#include "memory.h"
+
+namespace {
+  struct task {
+    size_t range;
+    uintptr_t address;
+    size_t scanSize;
+    size_t size;
+  };
+
+  // A worker's pair of buffers, handed back and forth between its reader and its matcher
+  struct lane {
+    unsigned char* buffers[2];
+    // Which pages of each buffer were actually read
+    std::vector<uint8_t> validPages[2];
+    size_t tasks[2];
+    // Chunks read and visited so far; buffer `n % 2` holds the n-th
+    size_t produced = 0;
+    size_t consumed = 0;
+    bool finished = false;
+    std::mutex mutex;
+    std::condition_variable changed;
+  };
+
+  // Chunk buffers start on a cache line, which also suits aligned vector loads
+  const size_t bufferAlignment = 64;
+
+  // Chunks are not shrunk below this to fit a memory cap, fewer threads are used instead
+  const size_t minimumChunkSize = 64 * 1024;
+
+  std::mutex optionsMutex;
+  scanner::options currentOptions = { 0, 0, 0 };
+}
+
+void scanner::setOptions(const options& value) {
+  std::lock_guard<std::mutex> lock(optionsMutex);
+  currentOptions = value;
+}
+
+scanner::options scanner::getOptions() {
+  std::lock_guard<std::mutex> lock(optionsMutex);
+  return currentOptions;
+}
+
+size_t scanner::threadCount() {
+  size_t threads = getOptions().threads;
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  return threads == 0 ? 1 : threads;
+}
+
+size_t scanner::chunkSize() {
+  size_t size = getOptions().chunkSize;
+  return size == 0 ? 2 * 1024 * 1024 : size;
+}
+
+size_t scanner::forEachChunk(pid_t hProcess, const std::vector<range>& ranges, size_t overlap, chunkVisitor visit, const std::atomic<bool>* cancelled) {
+  const size_t maxMemory = getOptions().maxMemory;
+  size_t size = chunkSize();
+  size_t threads = threadCount();
+
+  // Every worker double-buffers: one buffer is matched while the next chunk is read into the
+  // other. Fit the pool under the memory cap: smaller chunks first, then fewer workers. One
+  // worker (and so two buffers) is always allowed, however small the cap.
+  if (maxMemory != 0) {
+    while (size > minimumChunkSize && 2 * threads * (size + overlap) > maxMemory) size /= 2;
+    if (2 * threads * (size + overlap) > maxMemory) {
+      threads = maxMemory / (2 * (size + overlap));
+      if (threads == 0) threads = 1;
+    }
+  }
+
+  // Split every range into chunks, the lookahead never extends past the end of its range
+  std::vector<task> tasks;
+  for (size_t r = 0; r < ranges.size(); r++) {
+    for (uintptr_t address = ranges[r].start; address < ranges[r].end; address += size) {
+      size_t scanSize = ranges[r].end - address < size ? ranges[r].end - address : size;
+      size_t lookahead = ranges[r].end - address - scanSize < overlap ? ranges[r].end - address - scanSize : overlap;
+      tasks.push_back({ r, address, scanSize, scanSize + lookahead });
+    }
+  }
+
+  if (tasks.empty()) return 0;
+  if (threads > tasks.size()) threads = tasks.size();
+
+  // Buffers are allocated once per scan and recycled between chunks
+  const size_t stride = (size + overlap + bufferAlignment - 1) / bufferAlignment * bufferAlignment;
+  std::vector<unsigned char> storage(2 * threads * stride + bufferAlignment);
+  unsigned char* pool = storage.data() + (bufferAlignment - (uintptr_t)storage.data() % bufferAlignment) % bufferAlignment;
+
+  // Chunks are claimed in order by whichever worker has a free buffer first
+  std::atomic<size_t> nextTask(0);
+  std::atomic<bool> stopped(false);
+
+  std::vector<lane> lanes(threads);
+  std::vector<std::thread> workers;
+
+  for (size_t w = 0; w < threads; w++) {
+    lane* own = &lanes[w];
+    own->buffers[0] = pool + 2 * w * stride;
+    own->buffers[1] = pool + (2 * w + 1) * stride;
+
+    // The reader copies chunks out of the target process while the matcher visits the one
+    // read before, so every worker keeps its own process_vm_readv calls in flight
+    workers.emplace_back([&, own]() {
+      memory Memory;
+      for (;;) {
+        size_t slot;
+        {
+          std::unique_lock<std::mutex> lock(own->mutex);
+          own->changed.wait(lock, [&]() { return own->produced - own->consumed < 2; });
+          slot = own->produced % 2;
+        }
+
+        size_t index = stopped.load() || (cancelled != NULL && cancelled->load()) ? tasks.size() : nextTask.fetch_add(1);
+        if (index >= tasks.size()) break;
+
+        // A chunk with an unreadable page still yields the readable rest
+        Memory.readMemoryPartial(hProcess, tasks[index].address, own->buffers[slot], tasks[index].size, &own->validPages[slot]);
+
+        {
+          std::lock_guard<std::mutex> lock(own->mutex);
+          own->tasks[slot] = index;
+          own->produced++;
+        }
+        own->changed.notify_one();
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(own->mutex);
+        own->finished = true;
+      }
+      own->changed.notify_one();
+    });
+
+    workers.emplace_back([&, own]() {
+      for (;;) {
+        size_t slot;
+        {
+          std::unique_lock<std::mutex> lock(own->mutex);
+          own->changed.wait(lock, [&]() { return own->consumed < own->produced || own->finished; });
+          if (own->consumed == own->produced) return;
+          slot = own->consumed % 2;
+        }
+
+        // Once stopped, chunks that were read but not yet visited are dropped
+        const size_t index = own->tasks[slot];
+        const task& current = tasks[index];
+        if (!stopped.load() && (cancelled == NULL || !cancelled->load())) {
+          if (!visit({ index, current.range, current.address, own->buffers[slot], current.scanSize, current.size, own->validPages[slot].data() })) {
+            stopped = true;
+          }
+        }
+
+        {
+          std::lock_guard<std::mutex> lock(own->mutex);
+          own->consumed++;
+        }
+        own->changed.notify_one();
+      }
+    });
+  }
+
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  return tasks.size();
+}
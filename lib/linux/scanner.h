@@ -0,0 +1,60 @@
+#pragma once
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include <node.h>
+#include <unistd.h>
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <functional>
+
+// Reads address ranges of another process in fixed-size chunks and hands them to a
+// visitor on a pool of workers. Every worker reads its own chunks and double-buffers:
+// the next chunk is copied into its spare buffer while the current one is matched.
+class scanner {
+public:
+  struct range {
+    uintptr_t start;
+    uintptr_t end;
+  };
+
+  struct chunk {
+    // Chunks are numbered in address order across all ranges
+    size_t index;
+    size_t range;
+    uintptr_t address;
+    const unsigned char* data;
+    // Bytes that belong to this chunk; the `size - scanSize` bytes after them are
+    // lookahead copied from the next chunk so matches crossing the boundary are found
+    size_t scanSize;
+    size_t size;
+    // One bit per page, starting with the page that contains `address`. Pages that
+    // could not be read have a clear bit and read as zeros in `data`.
+    const uint8_t* validPages;
+  };
+
+  // Limits for scans; 0 leaves a setting at its default. Scans buffer `2 * threads` chunks
+  // plus lookahead, so at most `maxMemory` bytes of target memory are held at once.
+  struct options {
+    size_t maxMemory;
+    size_t chunkSize;
+    size_t threads;
+  };
+
+  // Returns false to stop handing out further chunks (chunks already being visited finish).
+  // `data` is only valid during the call, its buffer is reused for a later chunk.
+  typedef std::function<bool(const chunk& current)> chunkVisitor;
+
+  // Visits every chunk of `ranges`, `overlap` bytes of lookahead each. Chunks are
+  // claimed in order but may complete in any order. Returns the number of chunks.
+  static size_t forEachChunk(pid_t hProcess, const std::vector<range>& ranges, size_t overlap, chunkVisitor visit, const std::atomic<bool>* cancelled = NULL);
+
+  static void setOptions(const options& value);
+  static options getOptions();
+
+  static size_t threadCount();
+  static size_t chunkSize();
+};
+
+#endif
@@ -0,0 +1,653 @@
+#include <node.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <cstring>
+#include <algorithm>
+#include "scansession.h"
+#include "memory.h"
+#include "blockcompressor.h"
+
+namespace {
+  // Pages read by one process_vm_readv call: IOV_MAX iovecs of one page each
+  const size_t pagesPerRead = 1024;
+
+  size_t slotCount(size_t alignment) {
+    return alignment <= scanSession::blockSize ? scanSession::blockSize / alignment : 0;
+  }
+
+  size_t bitmapBytes(size_t alignment) {
+    return (slotCount(alignment) + 7) / 8;
+  }
+
+  // A snapshot covers the block and the bytes that the values of its last slots run into
+  size_t snapshotSize(size_t size) {
+    return scanSession::blockSize + size - 1;
+  }
+
+  void setBits(unsigned char* bitmap, size_t from, size_t to) {
+    for (; from < to && from % 8 != 0; from++) bitmap[from / 8] |= (unsigned char)(1 << (from % 8));
+    if (to - from >= 8) {
+      memset(bitmap + from / 8, 0xFF, (to - from) / 8);
+      from += (to - from) / 8 * 8;
+    }
+    for (; from < to; from++) bitmap[from / 8] |= (unsigned char)(1 << (from % 8));
+  }
+
+  // Appends a block holding `count` candidates, choosing whichever encoding is smaller.
+  // Returns false if the arena cannot grow.
+  bool appendBlock(scanSession::candidateSet& set, uintptr_t start, const uint16_t* offsets, const unsigned char* values, size_t count, size_t size, size_t alignment) {
+    if (count == 0) return true;
+
+    const size_t bitmapSize = bitmapBytes(alignment);
+    const bool dense = slotCount(alignment) != 0 && bitmapSize < count * sizeof(uint16_t);
+    const size_t data = set.arena.size();
+
+    if (dense) {
+      if (!set.arena.resize(data + bitmapSize)) return false;
+      unsigned char* bitmap = set.arena.data() + data;
+      for (size_t i = 0; i < count; i++) {
+        size_t slot = offsets[i] / alignment;
+        bitmap[slot / 8] |= (unsigned char)(1 << (slot % 8));
+      }
+    } else if (!set.arena.append(offsets, count * sizeof(uint16_t))) {
+      return false;
+    }
+
+    if (!set.arena.append(values, count * size)) {
+      set.arena.resize(data);
+      return false;
+    }
+
+    set.blocks.push_back({ start, data, (uint32_t)count, dense ? scanSession::E_BITMAP : scanSession::E_OFFSETS });
+    set.count += count;
+    return true;
+  }
+
+  // Appends a block whose candidates are the set bits of `bitmap` and whose values are
+  // taken from `memory`, a copy of the block's snapshotSize bytes. Pages holding nothing
+  // but zeros are left out and the rest is compressed. Returns false if the arena cannot grow.
+  bool appendSnapshot(scanSession::candidateSet& set, uintptr_t start, const unsigned char* bitmap, size_t count, const unsigned char* memory, size_t size, size_t alignment) {
+    if (count == 0) return true;
+
+    const size_t page = memory::pageSize();
+    const size_t length = snapshotSize(size);
+    const size_t data = set.arena.size();
+
+    uint64_t zeroPages = 0;
+    std::vector<unsigned char> stored;
+    stored.reserve(length);
+
+    for (size_t i = 0; i * page < length; i++) {
+      const unsigned char* from = memory + i * page;
+      const size_t bytes = std::min(page, length - i * page);
+
+      if (std::all_of(from, from + bytes, [](unsigned char byte) { return byte == 0; })) {
+        zeroPages |= (uint64_t)1 << i;
+      } else {
+        stored.insert(stored.end(), from, from + bytes);
+      }
+    }
+
+    // The compressed length goes in front of the compressed bytes
+    const size_t lengthAt = data + bitmapBytes(alignment) + sizeof(zeroPages);
+    if (!set.arena.resize(lengthAt + sizeof(uint32_t) + blockCompressor::compressBound(stored.size()))) return false;
+    memcpy(set.arena.data() + data, bitmap, bitmapBytes(alignment));
+    memcpy(set.arena.data() + data + bitmapBytes(alignment), &zeroPages, sizeof(zeroPages));
+
+    uint32_t compressed = (uint32_t)blockCompressor::compress(stored.data(), stored.size(), set.arena.data() + lengthAt + sizeof(uint32_t));
+    memcpy(set.arena.data() + lengthAt, &compressed, sizeof(compressed));
+    set.arena.resize(lengthAt + sizeof(uint32_t) + compressed);
+
+    set.blocks.push_back({ start, data, (uint32_t)count, scanSession::E_SNAPSHOT });
+    set.count += count;
+    return true;
+  }
+
+  // Restores the memory of a snapshot block into `scratch` and returns it
+  const unsigned char* restoreSnapshot(const unsigned char* header, size_t size, std::vector<unsigned char>& scratch) {
+    const size_t page = memory::pageSize();
+    const size_t length = snapshotSize(size);
+
+    uint64_t zeroPages;
+    uint32_t compressed;
+    memcpy(&zeroPages, header, sizeof(zeroPages));
+    memcpy(&compressed, header + sizeof(zeroPages), sizeof(compressed));
+    const unsigned char* payload = header + sizeof(zeroPages) + sizeof(compressed);
+
+    size_t stored = 0;
+    for (size_t i = 0; i * page < length; i++) {
+      if (!((zeroPages >> i) & 1)) stored += std::min(page, length - i * page);
+    }
+
+    // With zero pages left out, the stored pages are restored into the upper half and then
+    // spread out around them
+    scratch.resize(2 * length);
+    unsigned char* restored = scratch.data();
+    unsigned char* packed = zeroPages == 0 ? restored : restored + length;
+
+    if (!blockCompressor::decompress(payload, compressed, packed, stored)) {
+      memset(restored, 0, length);
+      return restored;
+    }
+
+    if (zeroPages != 0) {
+      for (size_t i = 0; i * page < length; i++) {
+        const size_t bytes = std::min(page, length - i * page);
+        if ((zeroPages >> i) & 1) {
+          memset(restored + i * page, 0, bytes);
+        } else {
+          memcpy(restored + i * page, packed, bytes);
+          packed += bytes;
+        }
+      }
+    }
+
+    return restored;
+  }
+
+  // Calls `visit(offset, value)` for every candidate of `current` in address order. Snapshot
+  // blocks are decompressed into `scratch`; without one their values are passed as NULL.
+  template <typename Visitor>
+  void forEachCandidate(const scanSession::candidateSet& set, const scanSession::block& current, size_t size, size_t alignment, std::vector<unsigned char>* scratch, Visitor visit) {
+    const unsigned char* data = set.arena.data() + current.data;
+
+    if (current.encoding == scanSession::E_OFFSETS) {
+      const unsigned char* values = data + current.count * sizeof(uint16_t);
+
+      for (size_t i = 0; i < current.count; i++) {
+        uint16_t offset;
+        memcpy(&offset, data + i * sizeof(uint16_t), sizeof(uint16_t));
+        visit(offset, values + i * size);
+      }
+      return;
+    }
+
+    const size_t bitmapSize = bitmapBytes(alignment);
+    const bool snapshot = current.encoding == scanSession::E_SNAPSHOT;
+    const unsigned char* values = data + bitmapSize;
+    if (snapshot) values = scratch != NULL ? restoreSnapshot(values, size, *scratch) : NULL;
+
+    for (size_t word = 0; word < bitmapSize; word += 8) {
+      uint64_t bits = 0;
+      if (bitmapSize - word >= 8) {
+        memcpy(&bits, data + word, 8);
+      } else {
+        memcpy(&bits, data + word, bitmapSize - word);
+      }
+
+      while (bits != 0) {
+        size_t offset = (word * 8 + __builtin_ctzll(bits)) * alignment;
+        if (snapshot) {
+          visit(offset, values != NULL ? values + offset : NULL);
+        } else {
+          visit(offset, values);
+          values += size;
+        }
+        bits &= bits - 1;
+      }
+    }
+  }
+
+  // Appends the blocks of `part` to `set`, or returns false if the arena cannot grow
+  bool appendSet(scanSession::candidateSet& set, const scanSession::candidateSet& part) {
+    const size_t base = set.arena.size();
+    if (!set.arena.append(part.arena.data(), part.arena.size())) return false;
+
+    for (scanSession::block current : part.blocks) {
+      current.data += base;
+      set.blocks.push_back(current);
+    }
+    set.count += part.count;
+    return true;
+  }
+
+  template <typename T>
+  struct tester {
+    scanSession::predicate test;
+    T operand;
+    T upper;
+
+    bool operator()(const unsigned char* current, const unsigned char* previous) const {
+      T now, before;
+      memcpy(&now, current, sizeof(T));
+      memcpy(&before, previous, sizeof(T));
+
+      switch (test) {
+        case scanSession::P_CHANGED:
+        case scanSession::P_UNCHANGED: {
+          // Bitwise equality keeps NaNs unchanged, value equality treats 0.0 and -0.0 as the same
+          bool same = memcmp(current, previous, sizeof(T)) == 0 || now == before;
+          return test == scanSession::P_UNCHANGED ? same : !same;
+        }
+        case scanSession::P_INCREASED: return now > before;
+        case scanSession::P_DECREASED: return now < before;
+        case scanSession::P_EQUAL: return now == operand;
+        case scanSession::P_RANGE: return now >= operand && now <= upper;
+      }
+
+      return false;
+    }
+  };
+
+  // Narrows blocks [first, last) of `input` into `output`. Blocks are taken in batches of
+  // up to pagesPerRead pages, every page with a candidate is read in one batched read.
+  // With `snapshots`, blocks that keep most of their slots are stored as snapshots of the
+  // pages just read rather than as one value per candidate. Returns false if `output`
+  // cannot grow.
+  template <typename T>
+  bool narrowBlocks(pid_t hProcess, const scanSession::candidateSet& input, size_t first, size_t last, size_t alignment, bool snapshots, const tester<T>& keep, scanSession::candidateSet& output, const std::atomic<bool>* cancelled) {
+    // A constant size lets the compiler inline every copy and compare of a value
+    const size_t size = sizeof(T);
+    const size_t page = memory::pageSize();
+    const size_t pageShift = __builtin_ctzll(page);
+    // A value may run into the first page of the next block
+    const size_t blockPages = scanSession::blockSize / page + 1;
+
+    memory Memory;
+    std::vector<memory::batchEntry> entries;
+    std::vector<unsigned char> buffer;
+    std::vector<int32_t> slots;
+    std::vector<unsigned char> scratch;
+    // Sized for a block where every slot is a candidate
+    const size_t maxCandidates = scanSession::blockSize / (alignment < scanSession::blockSize ? alignment : scanSession::blockSize);
+    std::vector<uint16_t> offsets(maxCandidates);
+    std::vector<unsigned char> values(maxCandidates * size);
+    std::vector<unsigned char> snapshot;
+    std::vector<unsigned char> bitmap;
+
+    // Everything that is kept fits in the space the input took. Without room for all of it,
+    // the arena grows as blocks are appended.
+    output.arena.reserve(last == input.blocks.size() ? input.arena.size() - input.blocks[first].data : input.blocks[last].data - input.blocks[first].data);
+
+    for (size_t batchStart = first; batchStart < last;) {
+      if (cancelled != NULL && cancelled->load()) return true;
+
+      size_t batchEnd = batchStart;
+      entries.clear();
+      slots.clear();
+
+      // Pages of a block get consecutive entries, so a value that crosses into the next
+      // page is contiguous in the buffer whenever both pages were read
+      while (batchEnd < last && (batchEnd == batchStart || entries.size() + blockPages <= pagesPerRead)) {
+        const scanSession::block& current = input.blocks[batchEnd];
+        slots.resize(slots.size() + blockPages, -1);
+        int32_t* blockSlots = slots.data() + slots.size() - blockPages;
+
+        if (current.encoding != scanSession::E_OFFSETS && page / alignment >= 8) {
+          // Bitmap blocks are marked page by page. Elements only cross into the next page
+          // when they are wider than their alignment.
+          const size_t pageBytes = page / alignment / 8;
+          const unsigned char* bits = input.arena.data() + current.data;
+          for (size_t i = 0; i + 1 < blockPages; i++) {
+            const unsigned char* pageBits = bits + i * pageBytes;
+            if (std::all_of(pageBits, pageBits + pageBytes, [](unsigned char byte) { return byte == 0; })) continue;
+
+            blockSlots[i] = 0;
+            if (size > alignment) blockSlots[i + 1] = 0;
+          }
+        } else {
+          forEachCandidate(input, current, size, alignment, NULL, [&](size_t offset, const unsigned char*) {
+            blockSlots[offset >> pageShift] = 0;
+            blockSlots[(offset + size - 1) >> pageShift] = 0;
+          });
+        }
+
+        for (size_t i = 0; i < blockPages; i++) {
+          if (blockSlots[i] < 0) continue;
+          blockSlots[i] = (int32_t)entries.size();
+          entries.push_back({ current.start + i * page, NULL, page, false });
+        }
+
+        batchEnd++;
+      }
+
+      buffer.resize(entries.size() * page);
+      for (size_t i = 0; i < entries.size(); i++) {
+        entries[i].buffer = buffer.data() + i * page;
+      }
+      Memory.readMemoryBatch(hProcess, entries.data(), entries.size());
+
+      for (size_t b = batchStart; b < batchEnd; b++) {
+        const scanSession::block& current = input.blocks[b];
+        const int32_t* blockSlots = slots.data() + (b - batchStart) * blockPages;
+        size_t kept = 0;
+
+        forEachCandidate(input, current, size, alignment, &scratch, [&](size_t offset, const unsigned char* previous) {
+          int32_t firstSlot = blockSlots[offset >> pageShift];
+          int32_t lastSlot = blockSlots[(offset + size - 1) >> pageShift];
+          if (!entries[firstSlot].ok || !entries[lastSlot].ok) return;
+
+          const unsigned char* now = buffer.data() + firstSlot * page + (offset & (page - 1));
+          if (!keep(now, previous)) return;
+
+          offsets[kept] = (uint16_t)offset;
+          memcpy(values.data() + kept * size, now, size);
+          kept++;
+        });
+
+        // A snapshot pays off once the values alone would take half the block
+        if (!snapshots || kept * size <= scanSession::blockSize / 2) {
+          if (!appendBlock(output, current.start, offsets.data(), values.data(), kept, size, alignment)) return false;
+          continue;
+        }
+
+        snapshot.assign(snapshotSize(size), 0);
+        for (size_t i = 0; i < blockPages && i * page < snapshot.size(); i++) {
+          if (blockSlots[i] < 0 || !entries[blockSlots[i]].ok) continue;
+          memcpy(snapshot.data() + i * page, buffer.data() + blockSlots[i] * page, std::min(page, snapshot.size() - i * page));
+        }
+
+        bitmap.assign(bitmapBytes(alignment), 0);
+        for (size_t i = 0; i < kept; i++) {
+          size_t slot = offsets[i] / alignment;
+          bitmap[slot / 8] |= (unsigned char)(1 << (slot % 8));
+        }
+
+        if (!appendSnapshot(output, current.start, bitmap.data(), kept, snapshot.data(), size, alignment)) return false;
+      }
+
+      batchStart = batchEnd;
+    }
+    return true;
+  }
+
+  // Splits the blocks between the scan threads by candidate count and joins their output.
+  // A cancelled pass, or one that runs out of memory, leaves the candidates as they were.
+  // Returns false in the latter case.
+  template <typename T>
+  bool narrow(pid_t hProcess, scanSession::candidateSet& candidates, size_t alignment, bool snapshots, const tester<T>& keep, const std::atomic<bool>* cancelled) {
+    size_t threads = scanner::threadCount();
+    const size_t candidatesPerThread = 64 * 1024;
+    if (threads > candidates.count / candidatesPerThread) threads = candidates.count / candidatesPerThread;
+    if (threads == 0) threads = 1;
+
+    std::vector<size_t> bounds(1, 0);
+    size_t seen = 0;
+    for (size_t b = 0; b < candidates.blocks.size(); b++) {
+      seen += candidates.blocks[b].count;
+      if (bounds.size() < threads && seen >= candidates.count / threads * bounds.size()) bounds.push_back(b + 1);
+    }
+    bounds.push_back(candidates.blocks.size());
+
+    std::vector<scanSession::candidateSet> parts(bounds.size() - 1);
+    std::vector<char> completed(parts.size(), 0);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i + 1 < bounds.size(); i++) {
+      parts[i].count = 0;
+      workers.emplace_back([&, i]() {
+        completed[i] = narrowBlocks(hProcess, candidates, bounds[i], bounds[i + 1], alignment, snapshots, keep, parts[i], cancelled);
+      });
+    }
+
+    for (std::thread& worker : workers) {
+      worker.join();
+    }
+
+    if (std::find(completed.begin(), completed.end(), 0) != completed.end()) {
+      return false;
+    }
+
+    if (cancelled != NULL && cancelled->load()) {
+      return true;
+    }
+
+    if (parts.size() == 1) {
+      candidates = std::move(parts[0]);
+    } else {
+      scanSession::candidateSet result;
+      result.count = 0;
+      for (scanSession::candidateSet& part : parts) {
+        if (!appendSet(result, part)) return false;
+        part = scanSession::candidateSet();
+      }
+      candidates = std::move(result);
+    }
+
+    // The arena was reserved for everything to be kept, give back what was not
+    if (candidates.arena.capacity() > candidates.arena.size() + candidates.arena.size() / 4) {
+      candidates.arena.shrinkToFit();
+    }
+    return true;
+  }
+
+  template <typename T>
+  bool narrowAs(pid_t hProcess, scanSession::candidateSet& candidates, size_t alignment, bool snapshots, scanSession::predicate test, const unsigned char* operand, const unsigned char* upper, const std::atomic<bool>* cancelled) {
+    tester<T> keep = { test, T(), T() };
+    if (operand != NULL) memcpy(&keep.operand, operand, sizeof(T));
+    if (upper != NULL) memcpy(&keep.upper, upper, sizeof(T));
+
+    return narrow<T>(hProcess, candidates, alignment, snapshots, keep, cancelled);
+  }
+}
+
+bool scanSession::parsePredicate(const char* name, predicate* result) {
+  if (!strcmp(name, "changed")) *result = P_CHANGED;
+  else if (!strcmp(name, "unchanged")) *result = P_UNCHANGED;
+  else if (!strcmp(name, "increased")) *result = P_INCREASED;
+  else if (!strcmp(name, "decreased")) *result = P_DECREASED;
+  else if (!strcmp(name, "equal")) *result = P_EQUAL;
+  else if (!strcmp(name, "range")) *result = P_RANGE;
+  else return false;
+
+  return true;
+}
+
+scanSession::scanSession(pid_t hProcess, memory::dataType type, size_t alignment)
+  : hProcess(hProcess), valueType(type), size(memory::dataTypeSize(type)), alignment(alignment), snapshots(false) {
+  candidates.count = 0;
+}
+
+bool scanSession::firstScan(const valueScanner::target& value, const std::vector<scanner::range>& ranges, const std::atomic<bool>* cancelled) {
+  candidates = candidateSet();
+  candidates.count = 0;
+  snapshots = false;
+
+  // Once the arena cannot grow, the rest of the matches are passed over
+  bool failed = false;
+
+  // Matches are grouped into blocks as they arrive, a block can continue in the next chunk.
+  // Every candidate's last value is the one that was searched for.
+  uintptr_t start = 0;
+  std::vector<uint16_t> offsets;
+  std::vector<unsigned char> values;
+
+  valueScanner::forEachMatch(hProcess, value, ranges, alignment, [&](const uintptr_t* addresses, size_t count) {
+    for (size_t i = 0; i < count && !failed; i++) {
+      if (addresses[i] - start >= blockSize) {
+        failed = !appendBlock(candidates, start, offsets.data(), values.data(), offsets.size(), size, alignment);
+        start = addresses[i] & ~(uintptr_t)(blockSize - 1);
+        offsets.clear();
+        values.clear();
+      }
+
+      offsets.push_back((uint16_t)(addresses[i] - start));
+      values.insert(values.end(), value.bytes, value.bytes + size);
+    }
+  }, cancelled);
+
+  if (!failed) failed = !appendBlock(candidates, start, offsets.data(), values.data(), offsets.size(), size, alignment);
+  candidates.arena.shrinkToFit();
+
+  if (failed || (cancelled != NULL && cancelled->load())) {
+    candidates = candidateSet();
+    candidates.count = 0;
+  }
+  return !failed;
+}
+
+bool scanSession::snapshotScan(const std::vector<scanner::range>& ranges, const std::atomic<bool>* cancelled) {
+  candidates = candidateSet();
+  candidates.count = 0;
+  snapshots = true;
+
+  if (slotCount(alignment) == 0) return true;
+
+  struct chunkBlocks {
+    bool done;
+    candidateSet set;
+  };
+
+  // Chunks are snapshotted on the scan threads and appended in address order
+  std::mutex mutex;
+  std::vector<chunkBlocks> chunks;
+  size_t frontier = 0;
+  const size_t page = memory::pageSize();
+  // Set when an arena cannot grow; no further chunks are handed out
+  std::atomic<bool> failed(false);
+
+  scanner::forEachChunk(hProcess, ranges, size - 1, [&](const scanner::chunk& current) {
+    if (failed.load()) return false;
+
+    candidateSet part;
+    part.count = 0;
+
+    const uintptr_t firstPage = current.address & ~(uintptr_t)(page - 1);
+    const uintptr_t scanEnd = current.address + current.scanSize;
+    const uintptr_t chunkEnd = current.address + current.size;
+    auto readable = [&](uintptr_t address) {
+      size_t index = (address - firstPage) / page;
+      return (current.validPages[index / 8] >> (index % 8)) & 1;
+    };
+
+    std::vector<unsigned char> snapshot(snapshotSize(size));
+    std::vector<unsigned char> bitmap(bitmapBytes(alignment));
+
+    // A block that straddles two chunks gets a block from each, holding the slots that
+    // start in that chunk
+    for (uintptr_t start = current.address & ~(uintptr_t)(blockSize - 1); start < scanEnd; start += blockSize) {
+      const uintptr_t from = std::max(start, current.address);
+      const uintptr_t to = std::min(start + snapshot.size(), chunkEnd);
+      std::fill(snapshot.begin(), snapshot.end(), 0);
+      memcpy(snapshot.data() + (from - start), current.data + (from - current.address), to - from);
+
+      // Every aligned slot whose value lies within readable pages
+      const uintptr_t slotsEnd = std::min(start + blockSize, scanEnd);
+      std::fill(bitmap.begin(), bitmap.end(), 0);
+      size_t count = 0;
+
+      for (uintptr_t run = from; run < slotsEnd;) {
+        const uintptr_t runPage = run & ~(uintptr_t)(page - 1);
+        if (!readable(run)) {
+          run = runPage + page;
+          continue;
+        }
+
+        uintptr_t runEnd = runPage + page;
+        while (runEnd < chunkEnd && readable(runEnd)) runEnd += page;
+        runEnd = std::min(runEnd, chunkEnd);
+
+        const uintptr_t slotFrom = (run + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        const uintptr_t slotTo = std::min(runEnd - size + 1, slotsEnd);
+        if (runEnd - run >= size && slotFrom < slotTo) {
+          size_t firstSlot = (slotFrom - start) / alignment;
+          size_t lastSlot = (slotTo - start + alignment - 1) / alignment;
+          setBits(bitmap.data(), firstSlot, lastSlot);
+          count += lastSlot - firstSlot;
+        }
+
+        run = runEnd;
+      }
+
+      if (!appendSnapshot(part, start, bitmap.data(), count, snapshot.data(), size, alignment)) {
+        failed = true;
+        return false;
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (chunks.size() <= current.index) chunks.resize(current.index + 1);
+    chunks[current.index].done = true;
+    chunks[current.index].set = std::move(part);
+
+    for (; frontier < chunks.size() && chunks[frontier].done; frontier++) {
+      if (!appendSet(candidates, chunks[frontier].set)) {
+        failed = true;
+        return false;
+      }
+      chunks[frontier].set = candidateSet();
+    }
+
+    return true;
+  }, cancelled);
+
+  candidates.arena.shrinkToFit();
+
+  if (failed.load() || (cancelled != NULL && cancelled->load())) {
+    candidates = candidateSet();
+    candidates.count = 0;
+  }
+  return !failed.load();
+}
+
+bool scanSession::nextScan(predicate test, const unsigned char* operand, const unsigned char* upper, const std::atomic<bool>* cancelled) {
+  switch (valueType) {
+    case memory::T_BYTE:
+    case memory::T_BOOL:
+      return narrowAs<uint8_t>(hProcess, candidates, alignment, snapshots, test, operand, upper, cancelled);
+    case memory::T_SHORT:
+      return narrowAs<int16_t>(hProcess, candidates, alignment, snapshots, test, operand, upper, cancelled);
+    case memory::T_INT32:
+      return narrowAs<int32_t>(hProcess, candidates, alignment, snapshots, test, operand, upper, cancelled);
+    case memory::T_UINT32:
+      return narrowAs<uint32_t>(hProcess, candidates, alignment, snapshots, test, operand, upper, cancelled);
+    case memory::T_INT64:
+    case memory::T_LONG:
+      return narrowAs<int64_t>(hProcess, candidates, alignment, snapshots, test, operand, upper, cancelled);
+    case memory::T_UINT64:
+    case memory::T_PTR:
+      return narrowAs<uint64_t>(hProcess, candidates, alignment, snapshots, test, operand, upper, cancelled);
+    case memory::T_FLOAT:
+      return narrowAs<float>(hProcess, candidates, alignment, snapshots, test, operand, upper, cancelled);
+    case memory::T_DOUBLE:
+      return narrowAs<double>(hProcess, candidates, alignment, snapshots, test, operand, upper, cancelled);
+    default:
+      break;
+  }
+
+  return true;
+}
+
+size_t scanSession::count() const {
+  return candidates.count;
+}
+
+size_t scanSession::memoryUsage() const {
+  return (candidates.arena.spilled() ? 0 : candidates.arena.capacity()) + candidates.blocks.capacity() * sizeof(block);
+}
+
+size_t scanSession::spilledSize() const {
+  return candidates.arena.spilled() ? candidates.arena.capacity() : 0;
+}
+
+memory::dataType scanSession::type() const {
+  return valueType;
+}
+
+size_t scanSession::valueSize() const {
+  return size;
+}
+
+void scanSession::getResults(size_t first, size_t limit, std::vector<uintptr_t>& addresses, std::vector<unsigned char>& values) const {
+  addresses.clear();
+  values.clear();
+
+  std::vector<unsigned char> scratch;
+  size_t skipped = 0;
+  for (const block& current : candidates.blocks) {
+    if (addresses.size() >= limit) break;
+
+    // Whole blocks before `first` are skipped without decoding them
+    if (skipped + current.count <= first) {
+      skipped += current.count;
+      continue;
+    }
+
+    forEachCandidate(candidates, current, size, alignment, &scratch, [&](size_t offset, const unsigned char* value) {
+      if (skipped++ < first || addresses.size() >= limit) return;
+
+      addresses.push_back(current.start + offset);
+      values.insert(values.end(), value, value + size);
+    });
+  }
+}
@@ -0,0 +1,101 @@
+#pragma once
+#ifndef SCANSESSION_H
+#define SCANSESSION_H
+
+#include <node.h>
+#include <unistd.h>
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include "memory.h"
+#include "scanner.h"
+#include "valuescanner.h"
+#include "spillbuffer.h"
+
+// The candidate set of a value search, narrowed down by repeated scans. Candidates are
+// kept in blocks of `blockSize` bytes of the target's address space, each storing the
+// candidates' offsets (or a bitmap of them when the block is dense) and their last values.
+// Sessions started without a value keep a compressed snapshot of the block instead.
+class scanSession {
+public:
+  enum predicate {
+    P_CHANGED,
+    P_UNCHANGED,
+    P_INCREASED,
+    P_DECREASED,
+    P_EQUAL,
+    P_RANGE
+  };
+
+  enum encoding {
+    // One uint16_t offset per candidate, then their values
+    E_OFFSETS,
+    // A bitmap with one bit per aligned slot, then the candidates' values
+    E_BITMAP,
+    // A bitmap, a uint64_t mask of the pages that only held zeros, the uint32_t length of
+    // the other pages compressed by blockCompressor and those compressed pages
+    E_SNAPSHOT
+  };
+
+  static const size_t blockSize = 64 * 1024;
+
+  struct block {
+    // Address of the start of the block, a multiple of blockSize
+    uintptr_t start;
+    // Where the block's candidates start in the arena, laid out as given by `encoding`
+    size_t data;
+    uint32_t count;
+    uint8_t encoding;
+  };
+
+  struct candidateSet {
+    std::vector<block> blocks;
+    // Moves to a temporary file beyond the spillBuffer memory limit
+    spillBuffer arena;
+    size_t count;
+  };
+
+  // Returns false for names other than changed, unchanged, increased, decreased, equal and range
+  static bool parsePredicate(const char* name, predicate* result);
+
+  // `type` must be accepted by valueScanner::targetFor
+  scanSession(pid_t hProcess, memory::dataType type, size_t alignment);
+
+  // The scans return false when the candidates no longer fit in memory or a temporary file.
+  // The first scans then leave the session without candidates.
+
+  // Starts over with every occurrence of `value` in `ranges` as the candidates
+  bool firstScan(const valueScanner::target& value, const std::vector<scanner::range>& ranges, const std::atomic<bool>* cancelled = NULL);
+
+  // Starts over with every aligned slot of `ranges` as a candidate, for searches whose
+  // initial value is unknown. Contents are kept as compressed snapshots, skipping zero pages.
+  bool snapshotScan(const std::vector<scanner::range>& ranges, const std::atomic<bool>* cancelled = NULL);
+
+  // Re-reads the pages that hold candidates and keeps those whose current value passes
+  // `test`; `operand` (and `upper` for P_RANGE) are values of the session's type. Candidates
+  // that can no longer be read are dropped. A cancelled scan, or one that runs out of
+  // space, leaves the candidates as they were.
+  bool nextScan(predicate test, const unsigned char* operand, const unsigned char* upper, const std::atomic<bool>* cancelled = NULL);
+
+  size_t count() const;
+  // Bytes held in memory for the candidates and their last values
+  size_t memoryUsage() const;
+  // Bytes of them that were moved to a temporary file
+  size_t spilledSize() const;
+  memory::dataType type() const;
+  size_t valueSize() const;
+
+  // Copies up to `limit` candidates, starting with the `first` in address order, and their last values
+  void getResults(size_t first, size_t limit, std::vector<uintptr_t>& addresses, std::vector<unsigned char>& values) const;
+
+private:
+  pid_t hProcess;
+  memory::dataType valueType;
+  size_t size;
+  size_t alignment;
+  // Set by snapshotScan: blocks that keep most of their slots stay snapshots when narrowed
+  bool snapshots;
+  candidateSet candidates;
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include <node.h>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <cinttypes>
+#include <mutex>
+#include <unordered_map>
+#include "signaturecache.h"
+#include "memory.h"
+
+namespace {
+  // The first line of a cache file: the prefix, a space and the format version
+  const char headerPrefix[] = "memoryjs signature cache";
+  const char fileHeader[] = "memoryjs signature cache 1";
+
+  // Pages of the module's first mapping that go into its content hash. The ELF
+  // headers and build id live there, so a rebuilt binary hashes differently.
+  const size_t hashedPages = 4;
+
+  std::mutex cacheMutex;
+  FILE* cacheFile = NULL;
+  std::unordered_map<std::string, uintptr_t> entries;
+
+  // "48 8B ? ?" form of a compiled signature, so spacing differences share an entry
+  std::string signatureText(const pattern::signature& sig) {
+    static const char digits[] = "0123456789ABCDEF";
+
+    std::string text;
+    for (size_t i = 0; i < sig.bytes.size(); i++) {
+      if (i != 0) text += ' ';
+
+      if (sig.mask[i] == 0) {
+        text += '?';
+      } else {
+        text += digits[sig.bytes[i] >> 4];
+        text += digits[sig.bytes[i] & 0xF];
+      }
+    }
+    return text;
+  }
+
+  // Every field of an entry but the offset, tab separated; the path comes last as it is the
+  // only one that may contain spaces
+  std::string entryKey(const signatureCache::identity& module, const pattern::signature& sig, uint32_t skip) {
+    char fields[128];
+    snprintf(fields, sizeof(fields), "%" PRIx64 "\t%" PRIu64 "\t%" PRIx64 "\t%016" PRIx64 "\t%u\t", module.dev, module.inode, module.size, module.contentHash, skip);
+    return fields + signatureText(sig) + '\t' + module.pathname;
+  }
+
+  bool writeEntry(FILE* file, const std::string& key, uintptr_t offset) {
+    return fprintf(file, "%" PRIxPTR "\t%s\n", offset, key.c_str()) > 0;
+  }
+}
+
+bool signatureCache::open(const char* path, const char** errorMessage) {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+
+  if (cacheFile != NULL) fclose(cacheFile);
+  cacheFile = NULL;
+  entries.clear();
+
+  // Later lines replace earlier ones with the same key
+  size_t lines = 0;
+  bool valid = false;
+  FILE* f = fopen(path, "r");
+
+  if (f == NULL && errno != ENOENT) {
+    *errorMessage = "cannot open signature cache";
+    return false;
+  }
+
+  if (f != NULL) {
+    size_t len = 0;
+    char *line = NULL;
+    ssize_t rc = 0;
+
+    while ((rc = getline(&line, &len, f)) != -1) {
+      if (rc > 0 && line[rc - 1] == '\n') line[rc - 1] = '\0';
+
+      if (!valid) {
+        // A file written by another version is started over, any other file is left alone
+        if (strcmp(line, fileHeader) == 0) {
+          valid = true;
+          continue;
+        }
+
+        if (strncmp(line, headerPrefix, sizeof(headerPrefix) - 1) != 0) {
+          free(line);
+          fclose(f);
+          *errorMessage = "not a signature cache file";
+          return false;
+        }
+        break;
+      }
+
+      char* key = strchr(line, '\t');
+      if (key == NULL) continue;
+
+      *key++ = '\0';
+      entries[key] = (uintptr_t)strtoull(line, NULL, 16);
+      lines++;
+    }
+
+    free(line);
+    fclose(f);
+  }
+
+  // Rewrite the file when it is new, empty, from another version or has piled up replaced entries
+  if (!valid || lines != entries.size()) {
+    std::string temporary = std::string(path) + ".tmp";
+    FILE* rewrite = fopen(temporary.c_str(), "w");
+    if (rewrite == NULL) {
+      *errorMessage = "cannot write signature cache";
+      return false;
+    }
+
+    bool ok = fprintf(rewrite, "%s\n", fileHeader) > 0;
+    for (const auto& entry : entries) {
+      ok = ok && writeEntry(rewrite, entry.first, entry.second);
+    }
+
+    if (fclose(rewrite) != 0 || !ok || rename(temporary.c_str(), path) != 0) {
+      remove(temporary.c_str());
+      *errorMessage = "cannot write signature cache";
+      return false;
+    }
+  }
+
+  cacheFile = fopen(path, "a");
+  if (cacheFile == NULL) {
+    *errorMessage = "cannot write signature cache";
+    return false;
+  }
+
+  return true;
+}
+
+void signatureCache::close() {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+
+  if (cacheFile != NULL) fclose(cacheFile);
+  cacheFile = NULL;
+  entries.clear();
+}
+
+bool signatureCache::enabled() {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  return cacheFile != NULL;
+}
+
+bool signatureCache::identify(pid_t hProcess, const module::Region& first, const std::string& pathname, const std::vector<scanner::range>& ranges, identity* result) {
+  if (first.inode == 0 || ranges.empty()) return false;
+
+  size_t size = hashedPages * memory::pageSize();
+  if (size > first.end - first.start) size = first.end - first.start;
+
+  memory Memory;
+  std::vector<unsigned char> pages(size);
+  size = Memory.readMemoryPartial(hProcess, first.start, pages.data(), size, NULL);
+  if (size == 0) return false;
+
+  result->pathname = pathname;
+  result->dev = first.dev;
+  result->inode = first.inode;
+  result->size = ranges.back().end - ranges.front().start;
+  result->contentHash = hash(pages.data(), size);
+  return true;
+}
+
+bool signatureCache::lookup(const identity& module, const pattern::signature& sig, uint32_t skip, uintptr_t* offset) {
+  std::string key = entryKey(module, sig, skip);
+  std::lock_guard<std::mutex> lock(cacheMutex);
+
+  auto entry = entries.find(key);
+  if (entry == entries.end()) return false;
+
+  *offset = entry->second;
+  return true;
+}
+
+void signatureCache::store(const identity& module, const pattern::signature& sig, uint32_t skip, uintptr_t offset) {
+  std::string key = entryKey(module, sig, skip);
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  if (cacheFile == NULL) return;
+
+  auto entry = entries.find(key);
+  if (entry != entries.end() && entry->second == offset) return;
+
+  entries[key] = offset;
+  writeEntry(cacheFile, key, offset);
+  fflush(cacheFile);
+}
+
+uint64_t signatureCache::hash(const void* data, size_t size, uint64_t seed) {
+  const unsigned char* bytes = (const unsigned char*)data;
+  uint64_t value = seed;
+
+  for (size_t i = 0; i < size; i++) {
+    value ^= bytes[i];
+    value *= 0x100000001b3ULL;
+  }
+  return value;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#ifndef SIGNATURECACHE_H
+#define SIGNATURECACHE_H
+
+#include <node.h>
+#include <unistd.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "module.h"
+#include "pattern.h"
+#include "scanner.h"
+
+// Optional on-disk cache of signature matches, stored as offsets from the module base.
+// Entries are keyed by the module's identity so a different build never reuses them.
+class signatureCache {
+public:
+  struct identity {
+    std::string pathname;
+    uint64_t dev;
+    uint64_t inode;
+    // Bytes spanned by the module's mappings
+    uint64_t size;
+    // FNV-1a of the first pages of the module
+    uint64_t contentHash;
+  };
+
+  // Loads the cache file at `path` (created if missing or empty) and enables the cache.
+  // New entries are appended to the file as they are found. Files that are not signature
+  // caches are refused rather than overwritten.
+  static bool open(const char* path, const char** errorMessage);
+  // Disables the cache and closes its file.
+  static void close();
+  static bool enabled();
+
+  // Fills `result` for the module whose first mapping is `first`, mapped from `pathname`. Returns
+  // false for modules that are not backed by a file or whose first page cannot be read.
+  static bool identify(pid_t hProcess, const module::Region& first, const std::string& pathname, const std::vector<scanner::range>& ranges, identity* result);
+
+  static bool lookup(const identity& module, const pattern::signature& sig, uint32_t skip, uintptr_t* offset);
+  static void store(const identity& module, const pattern::signature& sig, uint32_t skip, uintptr_t offset);
+
+  static uint64_t hash(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ULL);
+};
+
+#endif
@@ -0,0 +1,221 @@
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <atomic>
+#include "spillbuffer.h"
+
+namespace {
+  std::mutex optionsMutex;
+  spillBuffer::options currentOptions = { 0, "" };
+
+  // Bytes held in memory by all buffers
+  std::atomic<size_t> inMemory(0);
+
+  // Smaller buffers stay in memory whatever the limit, files are only made for bulk data
+  const size_t minimumSpill = 8 * 1024 * 1024;
+
+  // Written bytes are handed to the kernel for writeback in steps of this size, so dirty
+  // pages do not pile up until the whole buffer has been written
+  const size_t flushStep = 64 * 1024 * 1024;
+
+  // Opens an unnamed file that is removed once it is closed
+  int createTemporary() {
+    std::string directory = spillBuffer::getOptions().directory;
+    if (directory.empty()) {
+      const char* environment = getenv("TMPDIR");
+      directory = environment != NULL && environment[0] != '\0' ? environment : "/tmp";
+    }
+
+    int fd = open(directory.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (fd >= 0) return fd;
+
+    // Filesystems without O_TMPFILE: create a file and unlink it straight away
+    std::string path = directory + "/memoryjs-XXXXXX";
+    fd = mkostemp(&path[0], O_CLOEXEC);
+    if (fd >= 0) unlink(path.c_str());
+    return fd;
+  }
+
+  // Extends `fd` from `from` to `to` bytes with blocks allocated on disk. A file grown
+  // sparsely would only run out of space when a page of the mapping is first written,
+  // which raises SIGBUS instead of an error.
+  bool allocateFile(int fd, size_t from, size_t to) {
+    return posix_fallocate(fd, from, to - from) == 0;
+  }
+}
+
+void spillBuffer::setOptions(const options& value) {
+  std::lock_guard<std::mutex> lock(optionsMutex);
+  currentOptions = value;
+}
+
+spillBuffer::options spillBuffer::getOptions() {
+  std::lock_guard<std::mutex> lock(optionsMutex);
+  return currentOptions;
+}
+
+spillBuffer::spillBuffer() : bytes(NULL), length(0), allocated(0), fd(-1), flushed(0) {}
+
+spillBuffer::spillBuffer(spillBuffer&& other)
+  : bytes(other.bytes), length(other.length), allocated(other.allocated), fd(other.fd), flushed(other.flushed) {
+  other.bytes = NULL;
+  other.length = 0;
+  other.allocated = 0;
+  other.fd = -1;
+  other.flushed = 0;
+}
+
+spillBuffer& spillBuffer::operator=(spillBuffer&& other) {
+  if (this == &other) return *this;
+
+  release();
+  bytes = other.bytes;
+  length = other.length;
+  allocated = other.allocated;
+  fd = other.fd;
+  flushed = other.flushed;
+
+  other.bytes = NULL;
+  other.length = 0;
+  other.allocated = 0;
+  other.fd = -1;
+  other.flushed = 0;
+  return *this;
+}
+
+spillBuffer::~spillBuffer() {
+  release();
+}
+
+bool spillBuffer::reserve(size_t capacity) {
+  return capacity <= allocated || grow(capacity);
+}
+
+bool spillBuffer::resize(size_t size) {
+  if (size > allocated && !grow(size > 2 * allocated ? size : 2 * allocated)) return false;
+  if (size > length) memset(bytes + length, 0, size - length);
+  length = size;
+  return true;
+}
+
+bool spillBuffer::append(const void* data, size_t size) {
+  if (length + size > allocated && !grow(length + size > 2 * allocated ? length + size : 2 * allocated)) return false;
+  if (size != 0) memcpy(bytes + length, data, size);
+  length += size;
+
+  if (fd >= 0 && length - flushed >= flushStep) {
+    size_t end = length & ~(size_t)(flushStep - 1);
+    sync_file_range(fd, flushed, end - flushed, SYNC_FILE_RANGE_WRITE);
+    flushed = end;
+  }
+  return true;
+}
+
+void spillBuffer::shrinkToFit() {
+  if (length == allocated) return;
+  if (length == 0) {
+    release();
+    return;
+  }
+
+  if (fd >= 0) {
+    void* moved = mremap(bytes, allocated, length, MREMAP_MAYMOVE);
+    if (moved == MAP_FAILED) return;
+    bytes = (unsigned char*)moved;
+    if (ftruncate(fd, length) != 0) {
+      // A file that cannot be shortened only costs disk space until it is closed
+    }
+  } else {
+    unsigned char* moved = (unsigned char*)realloc(bytes, length);
+    if (moved == NULL) return;
+    bytes = moved;
+    inMemory -= allocated - length;
+  }
+
+  allocated = length;
+  if (flushed > length) flushed = length;
+}
+
+void spillBuffer::clear() {
+  release();
+}
+
+bool spillBuffer::grow(size_t capacity) {
+  if (fd >= 0) {
+    if (allocateFile(fd, allocated, capacity)) {
+      void* moved = mremap(bytes, allocated, capacity, MREMAP_MAYMOVE);
+      if (moved != MAP_FAILED) {
+        madvise(moved, capacity, MADV_SEQUENTIAL);
+        bytes = (unsigned char*)moved;
+        allocated = capacity;
+        return true;
+      }
+    }
+
+    // The file cannot grow (the disk may be full), carry on in memory
+    unsigned char* copy = (unsigned char*)malloc(capacity);
+    if (copy == NULL) return false;
+    memcpy(copy, bytes, length);
+    munmap(bytes, allocated);
+    close(fd);
+
+    bytes = copy;
+    allocated = capacity;
+    fd = -1;
+    flushed = 0;
+    inMemory += capacity;
+    return true;
+  }
+
+  const size_t limit = getOptions().memoryLimit;
+  if (limit != 0 && capacity >= minimumSpill && inMemory.load() + (capacity - allocated) > limit) {
+    int file = createTemporary();
+    void* mapped = MAP_FAILED;
+
+    if (file >= 0 && allocateFile(file, 0, capacity)) {
+      mapped = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    }
+
+    if (mapped != MAP_FAILED) {
+      madvise(mapped, capacity, MADV_SEQUENTIAL);
+      memcpy(mapped, bytes, length);
+      free(bytes);
+      inMemory -= allocated;
+
+      bytes = (unsigned char*)mapped;
+      allocated = capacity;
+      fd = file;
+      flushed = 0;
+      return true;
+    }
+
+    // Without a usable temporary file the buffer stays in memory
+    if (file >= 0) close(file);
+  }
+
+  unsigned char* moved = (unsigned char*)realloc(bytes, capacity);
+  if (moved == NULL) return false;
+  inMemory += capacity - allocated;
+  bytes = moved;
+  allocated = capacity;
+  return true;
+}
+
+void spillBuffer::release() {
+  if (fd >= 0) {
+    munmap(bytes, allocated);
+    close(fd);
+  } else {
+    free(bytes);
+    inMemory -= allocated;
+  }
+
+  bytes = NULL;
+  length = 0;
+  allocated = 0;
+  fd = -1;
+  flushed = 0;
+}
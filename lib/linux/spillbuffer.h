@@ -0,0 +1,62 @@
+#pragma once
+#ifndef SPILLBUFFER_H
+#define SPILLBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A growable byte buffer that is kept in memory while all buffers together stay under a
+// limit, and moved to a memory-mapped temporary file once growing it would cross the limit.
+// The file's disk space is allocated before it is mapped; when it cannot be, the buffer
+// stays in memory.
+// File pages are written back and dropped by the kernel, so spilled buffers should be read
+// and written front to back.
+class spillBuffer {
+public:
+  struct options {
+    // Bytes all buffers may hold in memory; 0 for no limit
+    size_t memoryLimit;
+    // Where temporary files are created; empty for $TMPDIR, or /tmp without it
+    std::string directory;
+  };
+
+  static void setOptions(const options& value);
+  static options getOptions();
+
+  spillBuffer();
+  spillBuffer(spillBuffer&& other);
+  spillBuffer& operator=(spillBuffer&& other);
+  spillBuffer(const spillBuffer&) = delete;
+  spillBuffer& operator=(const spillBuffer&) = delete;
+  ~spillBuffer();
+
+  unsigned char* data() { return bytes; }
+  const unsigned char* data() const { return bytes; }
+  size_t size() const { return length; }
+  size_t capacity() const { return allocated; }
+  // Whether the buffer lives in a temporary file
+  bool spilled() const { return fd >= 0; }
+
+  // These return false, leaving the buffer as it was, when neither memory nor disk space is left
+  bool reserve(size_t capacity);
+  // New bytes are zeroed
+  bool resize(size_t size);
+  bool append(const void* data, size_t size);
+  void shrinkToFit();
+  // Empties the buffer and releases its memory or file
+  void clear();
+
+private:
+  bool grow(size_t capacity);
+  void release();
+
+  unsigned char* bytes;
+  size_t length;
+  size_t allocated;
+  int fd;
+  // Bytes before this have been handed to the kernel for writeback
+  size_t flushed;
+};
+
+#endif
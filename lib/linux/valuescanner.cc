@@ -0,0 +1,298 @@
+#include <node.h>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <cstring>
+#include "valuescanner.h"
+#include "memory.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VALUESCANNER_X86
+#endif
+
+namespace {
+  // Compares `count` consecutive elements of the target's width starting at `data`, `value`
+  // holds the target repeated over 32 bytes. Appends `address` plus the offset of every match.
+  typedef void (*compareFunction)(const unsigned char* data, size_t count, const unsigned char* value, uintptr_t address, std::vector<uintptr_t>& hits);
+
+  template <size_t width, int kind>
+  inline bool equalAt(const unsigned char* data, const unsigned char* value) {
+    if (kind == valueScanner::C_FLOAT) {
+      float current, expected;
+      memcpy(&current, data, sizeof(float));
+      memcpy(&expected, value, sizeof(float));
+      return current == expected;
+    }
+
+    if (kind == valueScanner::C_DOUBLE) {
+      double current, expected;
+      memcpy(&current, data, sizeof(double));
+      memcpy(&expected, value, sizeof(double));
+      return current == expected;
+    }
+
+    return memcmp(data, value, width) == 0;
+  }
+
+  template <size_t width, int kind>
+  void compareScalar(const unsigned char* data, size_t count, const unsigned char* value, uintptr_t address, std::vector<uintptr_t>& hits) {
+    for (size_t i = 0; i < count; i++) {
+      if (equalAt<width, kind>(data + i * width, value)) hits.push_back(address + i * width);
+    }
+  }
+
+#ifdef VALUESCANNER_X86
+  // The compare sets every byte of a matching lane, so keeping the mask bit of each lane's
+  // first byte leaves one bit per match at that lane's offset
+  template <size_t width>
+  inline unsigned int laneBits() {
+    return width == 1 ? 0xFFFFFFFFu : width == 2 ? 0x55555555u : width == 4 ? 0x11111111u : 0x01010101u;
+  }
+
+  template <size_t width, int kind>
+  __attribute__((target("sse2")))
+  void compareSse2(const unsigned char* data, size_t count, const unsigned char* value, uintptr_t address, std::vector<uintptr_t>& hits) {
+    const __m128i expected = _mm_loadu_si128((const __m128i*)value);
+    const unsigned int lanes = laneBits<width>() & 0xFFFF;
+    const size_t bytes = count * width;
+
+    size_t position = 0;
+    for (; position + 16 <= bytes; position += 16) {
+      __m128i current = _mm_loadu_si128((const __m128i*)(data + position));
+      __m128i equal;
+
+      if (kind == valueScanner::C_FLOAT) {
+        equal = _mm_castps_si128(_mm_cmpeq_ps(_mm_castsi128_ps(current), _mm_castsi128_ps(expected)));
+      } else if (kind == valueScanner::C_DOUBLE) {
+        equal = _mm_castpd_si128(_mm_cmpeq_pd(_mm_castsi128_pd(current), _mm_castsi128_pd(expected)));
+      } else if (width == 1) {
+        equal = _mm_cmpeq_epi8(current, expected);
+      } else if (width == 2) {
+        equal = _mm_cmpeq_epi16(current, expected);
+      } else if (width == 4) {
+        equal = _mm_cmpeq_epi32(current, expected);
+      } else {
+        // SSE2 has no 64-bit compare: both halves of a lane have to be equal
+        equal = _mm_cmpeq_epi32(current, expected);
+        equal = _mm_and_si128(equal, _mm_shuffle_epi32(equal, _MM_SHUFFLE(2, 3, 0, 1)));
+      }
+
+      unsigned int matches = _mm_movemask_epi8(equal) & lanes;
+      while (matches != 0) {
+        hits.push_back(address + position + __builtin_ctz(matches));
+        matches &= matches - 1;
+      }
+    }
+
+    compareScalar<width, kind>(data + position, (bytes - position) / width, value, address + position, hits);
+  }
+
+  template <size_t width, int kind>
+  __attribute__((target("avx2")))
+  void compareAvx2(const unsigned char* data, size_t count, const unsigned char* value, uintptr_t address, std::vector<uintptr_t>& hits) {
+    const __m256i expected = _mm256_loadu_si256((const __m256i*)value);
+    const unsigned int lanes = laneBits<width>();
+    const size_t bytes = count * width;
+
+    size_t position = 0;
+    for (; position + 32 <= bytes; position += 32) {
+      __m256i current = _mm256_loadu_si256((const __m256i*)(data + position));
+      __m256i equal;
+
+      if (kind == valueScanner::C_FLOAT) {
+        equal = _mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(current), _mm256_castsi256_ps(expected), _CMP_EQ_OQ));
+      } else if (kind == valueScanner::C_DOUBLE) {
+        equal = _mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(current), _mm256_castsi256_pd(expected), _CMP_EQ_OQ));
+      } else if (width == 1) {
+        equal = _mm256_cmpeq_epi8(current, expected);
+      } else if (width == 2) {
+        equal = _mm256_cmpeq_epi16(current, expected);
+      } else if (width == 4) {
+        equal = _mm256_cmpeq_epi32(current, expected);
+      } else {
+        equal = _mm256_cmpeq_epi64(current, expected);
+      }
+
+      unsigned int matches = (unsigned int)_mm256_movemask_epi8(equal) & lanes;
+      while (matches != 0) {
+        hits.push_back(address + position + __builtin_ctz(matches));
+        matches &= matches - 1;
+      }
+    }
+
+    compareScalar<width, kind>(data + position, (bytes - position) / width, value, address + position, hits);
+  }
+#endif
+
+  // Picks the widest implementation the CPU supports
+  template <size_t width, int kind>
+  compareFunction selectFor() {
+#ifdef VALUESCANNER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return compareAvx2<width, kind>;
+    if (__builtin_cpu_supports("sse2")) return compareSse2<width, kind>;
+#endif
+    return compareScalar<width, kind>;
+  }
+
+  compareFunction selectCompare(const valueScanner::target& value) {
+    if (value.kind == valueScanner::C_FLOAT) return selectFor<4, valueScanner::C_FLOAT>();
+    if (value.kind == valueScanner::C_DOUBLE) return selectFor<8, valueScanner::C_DOUBLE>();
+
+    switch (value.size) {
+      case 1: return selectFor<1, valueScanner::C_INTEGER>();
+      case 2: return selectFor<2, valueScanner::C_INTEGER>();
+      case 4: return selectFor<4, valueScanner::C_INTEGER>();
+      default: return selectFor<8, valueScanner::C_INTEGER>();
+    }
+  }
+
+  // Compares every aligned element that starts in [from, to) of the chunk and ends before `end`
+  void scanRun(const scanner::chunk& current, size_t from, size_t end, size_t width, size_t alignment, compareFunction compare, const unsigned char* value, std::vector<uintptr_t>& hits) {
+    if (end - from < width) return;
+
+    const size_t to = std::min(current.scanSize, end - width + 1);
+    const size_t first = from + (alignment - (current.address + from) % alignment) % alignment;
+    const size_t before = hits.size();
+
+    // Alignments below the width need one strided pass per offset within an element
+    const size_t phases = alignment < width ? width / alignment : 1;
+    for (size_t phase = 0; phase < phases; phase++) {
+      size_t start = first + phase * alignment;
+      if (start >= to) break;
+
+      compare(current.data + start, (to - 1 - start) / width + 1, value, current.address + start, hits);
+    }
+
+    if (phases > 1) {
+      std::sort(hits.begin() + before, hits.end());
+    } else if (alignment > width) {
+      hits.erase(std::remove_if(hits.begin() + before, hits.end(), [&](uintptr_t address) { return address % alignment != 0; }), hits.end());
+    }
+  }
+
+  void scanChunk(const scanner::chunk& current, size_t width, size_t alignment, compareFunction compare, const unsigned char* value, std::vector<uintptr_t>& hits) {
+    const size_t page = memory::pageSize();
+    const uintptr_t firstPage = current.address & ~(uintptr_t)(page - 1);
+
+    auto valid = [&](size_t offset) {
+      size_t index = (current.address + offset - firstPage) / page;
+      return (current.validPages[index / 8] >> (index % 8)) & 1;
+    };
+    auto pageEnd = [&](size_t offset) {
+      size_t end = (current.address + offset - firstPage) / page * page + page + firstPage - current.address;
+      return end < current.size ? end : current.size;
+    };
+
+    // Elements never span an unreadable page, its zeros are not the target's memory
+    size_t from = 0;
+    while (from < current.scanSize) {
+      if (!valid(from)) {
+        from = pageEnd(from);
+        continue;
+      }
+
+      size_t end = pageEnd(from);
+      while (end < current.size && valid(end)) end = pageEnd(end);
+
+      scanRun(current, from, end, width, alignment, compare, value, hits);
+      from = end;
+    }
+  }
+}
+
+bool valueScanner::targetFor(memory::dataType type, target* result) {
+  switch (type) {
+    case memory::T_FLOAT:
+      result->kind = C_FLOAT;
+      break;
+    case memory::T_DOUBLE:
+      result->kind = C_DOUBLE;
+      break;
+    case memory::T_BYTE:
+    case memory::T_BOOL:
+    case memory::T_SHORT:
+    case memory::T_INT32:
+    case memory::T_UINT32:
+    case memory::T_INT64:
+    case memory::T_UINT64:
+    case memory::T_LONG:
+    case memory::T_PTR:
+      result->kind = C_INTEGER;
+      break;
+    default:
+      return false;
+  }
+
+  result->size = memory::dataTypeSize(type);
+  memset(result->bytes, 0, sizeof(result->bytes));
+  return result->size <= sizeof(result->bytes);
+}
+
+std::vector<scanner::range> valueScanner::writableRanges(const module::RegionTable& table) {
+  std::vector<scanner::range> ranges;
+
+  for (const module::Region& region : table.regions) {
+    if ((region.permissions & (module::P_READ | module::P_WRITE)) != (module::P_READ | module::P_WRITE)) continue;
+
+    // Shared memory files under /dev are ordinary memory, anything else there is a device
+    const char* pathname = table.pathname(region);
+    if (!strncmp(pathname, "/dev/", 5) && strncmp(pathname, "/dev/shm/", 9) && strncmp(pathname, "/dev/zero", 9)) continue;
+
+    if (!ranges.empty() && ranges.back().end == region.start) {
+      ranges.back().end = region.end;
+    } else {
+      ranges.push_back({ region.start, region.end });
+    }
+  }
+
+  return ranges;
+}
+
+void valueScanner::findValue(pid_t hProcess, const target& value, const std::vector<scanner::range>& ranges, size_t alignment, std::vector<uintptr_t>& results, const std::atomic<bool>* cancelled) {
+  results.clear();
+
+  forEachMatch(hProcess, value, ranges, alignment, [&](const uintptr_t* addresses, size_t count) {
+    results.insert(results.end(), addresses, addresses + count);
+  }, cancelled);
+
+  if (cancelled != NULL && cancelled->load()) {
+    results.clear();
+  }
+}
+
+void valueScanner::forEachMatch(pid_t hProcess, const target& value, const std::vector<scanner::range>& ranges, size_t alignment, matchVisitor visit, const std::atomic<bool>* cancelled) {
+  const compareFunction compare = selectCompare(value);
+  unsigned char repeated[32];
+  for (size_t i = 0; i < sizeof(repeated); i++) {
+    repeated[i] = value.bytes[i % value.size];
+  }
+
+  struct chunkHits {
+    bool done;
+    std::vector<uintptr_t> addresses;
+  };
+
+  // Chunks finish out of order; hits are handed on up to the first unfinished chunk so
+  // that they stay sorted
+  std::mutex mutex;
+  std::vector<chunkHits> chunks;
+  size_t frontier = 0;
+
+  scanner::forEachChunk(hProcess, ranges, value.size - 1, [&](const scanner::chunk& current) {
+    std::vector<uintptr_t> hits;
+    scanChunk(current, value.size, alignment, compare, repeated, hits);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (chunks.size() <= current.index) chunks.resize(current.index + 1);
+    chunks[current.index] = { true, std::move(hits) };
+
+    for (; frontier < chunks.size() && chunks[frontier].done; frontier++) {
+      visit(chunks[frontier].addresses.data(), chunks[frontier].addresses.size());
+      std::vector<uintptr_t>().swap(chunks[frontier].addresses);
+    }
+
+    return true;
+  }, cancelled);
+}
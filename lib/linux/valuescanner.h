@@ -0,0 +1,50 @@
+#pragma once
+#ifndef VALUESCANNER_H
+#define VALUESCANNER_H
+
+#include <node.h>
+#include <unistd.h>
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include "memory.h"
+#include "module.h"
+#include "scanner.h"
+
+// Finds every address in the writable memory of another process that holds a given value
+class valueScanner {
+public:
+  enum compareKind {
+    // Compared bit for bit
+    C_INTEGER,
+    // Compared as IEEE values, so 0.0 matches -0.0 and NaN matches nothing
+    C_FLOAT,
+    C_DOUBLE
+  };
+
+  struct target {
+    size_t size;
+    compareKind kind;
+    unsigned char bytes[8];
+  };
+
+  // Sets the size and comparison of `type`; false for types that cannot be scanned for
+  static bool targetFor(memory::dataType type, target* result);
+
+  // Readable and writable mappings of `table`, adjacent ones merged. Includes [heap], [stack]
+  // and anonymous mappings; device mappings are left out since reading them can have side effects.
+  static std::vector<scanner::range> writableRanges(const module::RegionTable& table);
+
+  // Called with the next matches in ascending order, as the chunks they were found in complete
+  typedef std::function<void(const uintptr_t* addresses, size_t count)> matchVisitor;
+
+  // Sets `results` to the address of every occurrence of `value` in `ranges` that is a multiple
+  // of `alignment` (a power of two), in ascending order. Unreadable pages are skipped.
+  static void findValue(pid_t hProcess, const target& value, const std::vector<scanner::range>& ranges, size_t alignment, std::vector<uintptr_t>& results, const std::atomic<bool>* cancelled = NULL);
+
+  // Like findValue, but streams the matches to `visit` instead of collecting them all
+  static void forEachMatch(pid_t hProcess, const target& value, const std::vector<scanner::range>& ranges, size_t alignment, matchVisitor visit, const std::atomic<bool>* cancelled = NULL);
+};
+
+#endif
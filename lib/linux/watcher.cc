@@ -0,0 +1,130 @@
+#include <node.h>
+#include <vector>
+#include <cstring>
+#include "watcher.h"
+#include "memory.h"
+
+watcher::watcher(pid_t hProcess, changeCallback onChange)
+  : hProcess(hProcess), onChange(onChange), nextId(1), stopping(false) {
+  thread = std::thread(&watcher::run, this);
+}
+
+watcher::~watcher() {
+  stop();
+}
+
+uint32_t watcher::add(uintptr_t address, memory::dataType type, uint32_t intervalMs) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  entry watched = {};
+  watched.id = nextId++;
+  watched.address = address;
+  watched.type = type;
+  watched.size = memory::dataTypeSize(type);
+  watched.interval = std::chrono::milliseconds(intervalMs == 0 ? 1 : intervalMs);
+  watched.due = clock::now();
+  watched.reported = false;
+  entries.push_back(watched);
+
+  wake.notify_one();
+  return watched.id;
+}
+
+bool watcher::remove(uint32_t id) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for (auto it = entries.begin(); it != entries.end(); ++it) {
+    if (it->id == id) {
+      entries.erase(it);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void watcher::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_one();
+
+  if (thread.joinable()) {
+    thread.join();
+  }
+}
+
+void watcher::run() {
+  memory Memory;
+  std::vector<size_t> due;
+  std::vector<memory::batchEntry> reads;
+  std::vector<unsigned char> values;
+  std::vector<change> changes;
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stopping) {
+    if (entries.empty()) {
+      wake.wait(lock);
+      continue;
+    }
+
+    clock::time_point now = clock::now();
+    clock::time_point next = clock::time_point::max();
+    due.clear();
+    for (size_t i = 0; i < entries.size(); i++) {
+      if (entries[i].due <= now) {
+        due.push_back(i);
+      } else if (entries[i].due < next) {
+        next = entries[i].due;
+      }
+    }
+
+    if (due.empty()) {
+      wake.wait_until(lock, next);
+      continue;
+    }
+
+    // Every entry that is due shares one batched read
+    values.assign(due.size() * sizeof(entry::value), 0);
+    reads.resize(due.size());
+    for (size_t i = 0; i < due.size(); i++) {
+      const entry& watched = entries[due[i]];
+      reads[i] = { watched.address, &values[i * sizeof(entry::value)], watched.size, false };
+    }
+
+    Memory.readMemoryBatch(hProcess, reads.data(), reads.size());
+
+    changes.clear();
+    for (size_t i = 0; i < due.size(); i++) {
+      entry& watched = entries[due[i]];
+      const unsigned char* value = (const unsigned char*)reads[i].buffer;
+
+      // Catch up without firing repeatedly if the thread fell behind
+      watched.due += watched.interval;
+      if (watched.due < now) watched.due = now + watched.interval;
+
+      bool changed = !watched.reported || watched.ok != reads[i].ok || memcmp(watched.value, value, watched.size) != 0;
+      if (!changed) {
+        continue;
+      }
+
+      watched.reported = true;
+      watched.ok = reads[i].ok;
+      memcpy(watched.value, value, watched.size);
+
+      change update = { watched.id, watched.address, watched.type, watched.ok, {0} };
+      memcpy(update.value, value, watched.size);
+      changes.push_back(update);
+    }
+
+    if (!changes.empty()) {
+      // Report outside the lock so the callback may add or remove entries
+      std::vector<change> report;
+      report.swap(changes);
+      lock.unlock();
+      onChange(std::move(report));
+      lock.lock();
+    }
+  }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#ifndef WATCHER_H
+#define WATCHER_H
+
+#include <node.h>
+#include <unistd.h>
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+#include "memory.h"
+
+// Polls a set of addresses on a background thread and reports only the values that changed.
+class watcher {
+public:
+  struct change {
+    uint32_t id;
+    uintptr_t address;
+    memory::dataType type;
+    // false if the address could not be read (value is zeroed)
+    bool ok;
+    unsigned char value[16];
+  };
+
+  // Called on the polling thread with every change found in one pass.
+  typedef std::function<void(std::vector<change>&& changes)> changeCallback;
+
+  watcher(pid_t hProcess, changeCallback onChange);
+  ~watcher();
+
+  // Starts watching `address`; its first value is always reported. Returns the entry's id.
+  uint32_t add(uintptr_t address, memory::dataType type, uint32_t intervalMs);
+  bool remove(uint32_t id);
+  // Stops the polling thread. No callbacks are made once this returns.
+  void stop();
+
+private:
+  typedef std::chrono::steady_clock clock;
+
+  struct entry {
+    uint32_t id;
+    uintptr_t address;
+    memory::dataType type;
+    size_t size;
+    clock::duration interval;
+    clock::time_point due;
+    bool reported;
+    bool ok;
+    unsigned char value[16];
+  };
+
+  void run();
+
+  pid_t hProcess;
+  changeCallback onChange;
+  std::vector<entry> entries;
+  uint32_t nextId;
+  bool stopping;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::thread thread;
+};
+
+#endif
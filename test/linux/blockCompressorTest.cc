@@ -0,0 +1,89 @@
+/*
+  Round-trips generated blocks through the compressor in lib/linux/blockcompressor.cc and
+  checks that damaged input is rejected or decoded without writing past the output.
+
+  Build and run from the repository root:
+    g++ -O2 -std=gnu++17 -Ilib/linux \
+      test/linux/blockCompressorTest.cc lib/linux/blockcompressor.cc -o blockCompressorTest
+    ./blockCompressorTest [inputs]
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "blockcompressor.h"
+
+namespace {
+  // Bytes after the output that decompress must leave alone
+  const size_t guardSize = 64;
+  const unsigned char guardByte = 0xA5;
+
+  // Fills `data` with one of the kinds of content process memory is made of
+  void generate(std::mt19937& random, int kind, std::vector<unsigned char>& data) {
+    for (size_t i = 0; i < data.size(); i++) {
+      switch (kind) {
+        case 0: data[i] = (unsigned char)random(); break;
+        case 1: data[i] = 0; break;
+        // Small integers in mostly zeroed structs
+        case 2: data[i] = i % 16 < 4 ? random() % 4 : 0; break;
+        // Repeats of earlier bytes at short distances
+        case 3: data[i] = i > 100 && random() % 10 ? data[i - 1 - random() % 100] : (unsigned char)random(); break;
+        // One long repeated pattern
+        default: data[i] = "abcabcabd"[i % 9]; break;
+      }
+    }
+  }
+
+  bool roundTrip(const std::vector<unsigned char>& input, std::mt19937& random) {
+    std::vector<unsigned char> compressed(blockCompressor::compressBound(input.size()));
+    size_t length = blockCompressor::compress(input.data(), input.size(), compressed.data());
+    if (length > compressed.size()) {
+      fprintf(stderr, "%zu bytes compressed to %zu, more than the bound\n", input.size(), length);
+      return false;
+    }
+
+    std::vector<unsigned char> output(input.size() + guardSize, guardByte);
+    if (!blockCompressor::decompress(compressed.data(), length, output.data(), input.size()) ||
+        (!input.empty() && memcmp(output.data(), input.data(), input.size()))) {
+      fprintf(stderr, "%zu bytes did not round-trip\n", input.size());
+      return false;
+    }
+
+    // Damaged input may decode to anything, but never beyond `size` bytes
+    if (length > 0 && length != input.size()) {
+      compressed[random() % length] ^= (unsigned char)(1 + random() % 255);
+      std::fill(output.begin(), output.end(), guardByte);
+      blockCompressor::decompress(compressed.data(), length, output.data(), input.size());
+    }
+
+    for (size_t i = input.size(); i < output.size(); i++) {
+      if (output[i] != guardByte) {
+        fprintf(stderr, "decompress wrote past %zu bytes\n", input.size());
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t inputs = argc > 1 ? strtoul(argv[1], NULL, 10) : 2000;
+  std::mt19937 random(1);
+  size_t failed = 0;
+
+  for (size_t i = 0; i < inputs; i++) {
+    // Snapshots are at most a block plus the bytes the last value runs into; tiny and
+    // empty inputs are covered too
+    size_t size = i % 50 == 0 ? random() % 20 : random() % (64 * 1024 + 8);
+    std::vector<unsigned char> input(size);
+    generate(random, (int)(i % 5), input);
+
+    if (!roundTrip(input, random)) failed++;
+  }
+
+  printf("%zu inputs, %zu failed\n", inputs, failed);
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,164 @@
+/*
+  Compares the /proc/<pid>/maps parser in lib/linux/module.cc with the getline + sscanf
+  parser it replaced, on a generated maps file with many mappings.
+
+  Build and run from the repository root:
+    g++ -O2 -std=gnu++17 -pthread -Ilib/linux \
+      -I"$(node -p "require('path').resolve(process.execPath, '../../include/node')")" \
+      test/linux/mapsParserBenchmark.cc lib/linux/module.cc -o mapsParserBenchmark
+    ./mapsParserBenchmark [mappings] [rounds]
+*/
+
+#include <node.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cinttypes>
+#include "module.h"
+
+namespace {
+  // The parser before the rewrite: one getline and sscanf per line
+  size_t parseWithSscanf(const char* path, std::vector<module::Module>* regions) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) return 0;
+
+    size_t len = 0;
+    char *line = NULL;
+    ssize_t rc = 0;
+    while ((rc = getline(&line, &len, f)) != -1) {
+      if (rc < 1) continue;
+      line[rc-1] = '\0';
+
+      module::Module result;
+      sscanf(line, "%" SCNxPTR "-%" SCNxPTR " %31s %llx %x:%x %llu", &result.start,
+            &result.end, result.permissions, &result.offset,
+            &result.dev_major, &result.dev_minor, &result.inode);
+
+      if (strchr(line, '/') != NULL) {
+        strcpy(result.pathname, strchr(line, '/'));
+      } else {
+        result.pathname[0] = '\0';
+      }
+
+      regions->push_back(result);
+    }
+    free(line);
+    fclose(f);
+
+    return regions->size();
+  }
+
+  // The current parser: the whole file with read() into a reused buffer, then parseMaps
+  size_t parseWithRead(const char* path, std::string* buffer, module::RegionTable* table) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+
+    size_t size = 0;
+    ssize_t rc;
+    buffer->resize(buffer->capacity() > 256 * 1024 ? buffer->capacity() : 256 * 1024);
+    while ((rc = read(fd, &(*buffer)[size], buffer->size() - size)) > 0) {
+      size += rc;
+      if (size == buffer->size()) buffer->resize(buffer->size() * 2);
+    }
+    close(fd);
+
+    return module::parseMaps(buffer->data(), size, table);
+  }
+
+  // Wine + Mono style layout: mostly small anonymous mappings between a few libraries
+  std::string generateMaps(size_t mappings) {
+    std::string text;
+    char line[512];
+    uintptr_t address = 0x7f0000000000;
+
+    for (size_t i = 0; i < mappings; i++) {
+      uintptr_t size = 0x1000 * (1 + i % 16);
+      if (i % 8 == 0) {
+        snprintf(line, sizeof(line), "%" PRIxPTR "-%" PRIxPTR " r-xp %08zx fd:01 %zu                     /usr/lib/wine/x86_64-unix/library%zu.so\n",
+                 address, address + size, (i % 64) * 0x1000, 1000000 + i / 8, i / 8);
+      } else {
+        snprintf(line, sizeof(line), "%" PRIxPTR "-%" PRIxPTR " rw-p 00000000 00:00 0 \n", address, address + size);
+      }
+      text += line;
+      address += size + 0x1000;
+    }
+
+    return text;
+  }
+
+  double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t mappings = argc > 1 ? strtoul(argv[1], NULL, 10) : 30000;
+  size_t rounds = argc > 2 ? strtoul(argv[2], NULL, 10) : 20;
+
+  char path[] = "/tmp/memoryjs-maps-XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    perror("mkstemp");
+    return 1;
+  }
+
+  std::string text = generateMaps(mappings);
+  if (write(fd, text.data(), text.size()) != (ssize_t)text.size()) {
+    perror("write");
+    return 1;
+  }
+  close(fd);
+
+  std::vector<module::Module> expected;
+  module::RegionTable table;
+  std::string buffer;
+
+  parseWithSscanf(path, &expected);
+  parseWithRead(path, &buffer, &table);
+
+  // Both parsers have to agree before their timings mean anything
+  const std::vector<module::Region>& regions = table.regions;
+  bool same = expected.size() == regions.size();
+  for (size_t i = 0; same && i < regions.size(); i++) {
+    char permissions[5];
+    module::permissionString(regions[i].permissions, permissions);
+
+    same = expected[i].start == regions[i].start && expected[i].end == regions[i].end &&
+           !strcmp(expected[i].permissions, permissions) && expected[i].offset == regions[i].offset &&
+           regions[i].dev == (expected[i].dev_major << 20 | expected[i].dev_minor) &&
+           expected[i].inode == regions[i].inode && !strcmp(expected[i].pathname, table.pathname(regions[i]));
+  }
+
+  if (!same) {
+    fprintf(stderr, "parsers disagree\n");
+    unlink(path);
+    return 1;
+  }
+
+  double sscanfTime = 0;
+  double readTime = 0;
+
+  for (size_t round = 0; round < rounds; round++) {
+    expected.clear();
+    auto start = std::chrono::steady_clock::now();
+    parseWithSscanf(path, &expected);
+    sscanfTime += millisecondsSince(start);
+
+    table = module::RegionTable();
+    start = std::chrono::steady_clock::now();
+    parseWithRead(path, &buffer, &table);
+    readTime += millisecondsSince(start);
+  }
+
+  unlink(path);
+
+  printf("%zu mappings, %zu rounds\n", mappings, rounds);
+  printf("getline + sscanf: %8.3f ms per parse\n", sscanfTime / rounds);
+  printf("read + parseMaps: %8.3f ms per parse\n", readTime / rounds);
+  return 0;
+}
@@ -0,0 +1,177 @@
+/*
+  Runs an unknown initial value search of lib/linux/scansession.cc over memory of this
+  process and checks every narrowing step against a plain model of the candidates. The
+  memory mixes zero pages, small integers and random bytes and has an unreadable hole, so
+  both snapshot and per-candidate blocks are exercised.
+
+  Build and run from the repository root:
+    g++ -O2 -std=gnu++17 -pthread -Ilib/linux \
+      -I"$(node -p "require('path').resolve(process.execPath, '../../include/node')")" \
+      test/linux/snapshotScanTest.cc lib/linux/scansession.cc lib/linux/scanner.cc \
+      lib/linux/valuescanner.cc lib/linux/memory.cc lib/linux/module.cc \
+      lib/linux/blockcompressor.cc lib/linux/spillbuffer.cc -o snapshotScanTest
+    ./snapshotScanTest
+*/
+
+#include <node.h>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "scansession.h"
+
+namespace {
+  const size_t bufferSize = 4 * 1024 * 1024;
+
+  struct fixture {
+    unsigned char* buffer;
+    // [holeStart, holeEnd) is mapped PROT_NONE
+    uintptr_t holeStart;
+    uintptr_t holeEnd;
+
+    bool readable(uintptr_t address, size_t size) const {
+      return address + size <= holeStart || address >= holeEnd;
+    }
+  };
+
+  template <typename T>
+  class checker {
+  public:
+    checker(const fixture& memory, scanSession& session, const char* name) : memory(memory), session(session), name(name), failed(0) {}
+
+    void snapshot(const std::vector<scanner::range>& ranges, size_t alignment) {
+      model.clear();
+      for (const scanner::range& range : ranges) {
+        for (uintptr_t address = (range.start + alignment - 1) & ~(uintptr_t)(alignment - 1); address + sizeof(T) <= range.end; address += alignment) {
+          if (memory.readable(address, sizeof(T))) model[address] = load(address);
+        }
+      }
+
+      session.snapshotScan(ranges);
+      verify("snapshot");
+    }
+
+    void narrow(scanSession::predicate test, const char* step) {
+      std::map<uintptr_t, T> kept;
+      for (const auto& candidate : model) {
+        if (!memory.readable(candidate.first, sizeof(T))) continue;
+
+        T now = load(candidate.first);
+        T before = candidate.second;
+        bool same = now == before || !memcmp(&now, &before, sizeof(T));
+        bool keep = test == scanSession::P_CHANGED ? !same : test == scanSession::P_UNCHANGED ? same :
+                    test == scanSession::P_INCREASED ? now > before : now < before;
+        if (keep) kept[candidate.first] = now;
+      }
+      model.swap(kept);
+
+      session.nextScan(test, NULL, NULL);
+      verify(step);
+    }
+
+    size_t failures() const { return failed; }
+
+  private:
+    static T load(uintptr_t address) {
+      T value;
+      memcpy(&value, (const void*)address, sizeof(T));
+      return value;
+    }
+
+    void verify(const char* step) {
+      std::vector<uintptr_t> addresses;
+      std::vector<unsigned char> values;
+      session.getResults(0, (size_t)-1, addresses, values);
+
+      bool same = session.count() == model.size() && addresses.size() == model.size();
+      size_t i = 0;
+      for (auto candidate = model.begin(); same && candidate != model.end(); ++candidate, i++) {
+        same = addresses[i] == candidate->first && !memcmp(values.data() + i * sizeof(T), &candidate->second, sizeof(T));
+      }
+
+      // A page from the middle has to start at the same candidate
+      if (same && model.size() > 20) {
+        auto middle = model.begin();
+        std::advance(middle, model.size() / 2);
+        session.getResults(model.size() / 2, 10, addresses, values);
+        same = addresses.size() == 10 && addresses[0] == middle->first;
+      }
+
+      if (!same) {
+        fprintf(stderr, "%s, %s: %zu candidates, expected %zu\n", name, step, session.count(), model.size());
+        failed++;
+      }
+    }
+
+    const fixture& memory;
+    scanSession& session;
+    const char* name;
+    std::map<uintptr_t, T> model;
+    size_t failed;
+  };
+
+  // Adds `delta` to one byte every `step` bytes outside the hole
+  void touch(const fixture& memory, size_t step, int delta) {
+    for (size_t i = 0; i < bufferSize; i += step) {
+      if (memory.readable((uintptr_t)memory.buffer + i, 1)) memory.buffer[i] += delta;
+    }
+  }
+
+  template <typename T>
+  size_t run(memory::dataType type, size_t alignment, const char* name, unsigned seed) {
+    fixture memory;
+    memory.buffer = (unsigned char*)mmap(NULL, bufferSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    const uintptr_t start = (uintptr_t)memory.buffer;
+    const size_t page = memory::pageSize();
+
+    // Every 64KB alternates between zeros, small integers, random bytes and half-zero blocks
+    std::mt19937 random(seed);
+    for (size_t i = 0; i < bufferSize; i += sizeof(uint32_t)) {
+      size_t zone = (i >> 16) % 4;
+      uint32_t value = zone == 0 ? 0 : zone == 1 ? random() % 8 : zone == 2 ? (uint32_t)random() : (i & 0xFFFF) < 0x8000 ? 0 : random() % 3;
+      memcpy(memory.buffer + i, &value, sizeof(value));
+    }
+
+    memory.holeStart = start + 2 * 1024 * 1024 + 3 * page;
+    memory.holeEnd = memory.holeStart + 5 * page;
+    mprotect((void*)memory.holeStart, memory.holeEnd - memory.holeStart, PROT_NONE);
+
+    // Ranges that do not line up with blocks
+    std::vector<scanner::range> ranges = {
+      { start + 7 * page + 12, start + 3 * 1024 * 1024 + 123 },
+      { start + 3 * 1024 * 1024 + 70000, start + bufferSize - 3 * page - 5 }
+    };
+
+    scanSession session(getpid(), type, alignment);
+    checker<T> check(memory, session, name);
+
+    check.snapshot(ranges, alignment);
+    check.narrow(scanSession::P_UNCHANGED, "unchanged");
+    touch(memory, sizeof(T) * 97, 3);
+    check.narrow(scanSession::P_UNCHANGED, "unchanged after writes");
+    touch(memory, sizeof(T) * 13, 1);
+    check.narrow(scanSession::P_CHANGED, "changed");
+    touch(memory, sizeof(T) * 3, -1);
+    check.narrow(scanSession::P_DECREASED, "decreased");
+    touch(memory, sizeof(T) * 5, 2);
+    check.narrow(scanSession::P_INCREASED, "increased");
+
+    munmap(memory.buffer, bufferSize);
+    return check.failures();
+  }
+}
+
+int main() {
+  size_t failed = 0;
+  failed += run<int32_t>(memory::T_INT32, 4, "int32", 1);
+  failed += run<int32_t>(memory::T_INT32, 1, "int32, unaligned", 2);
+  failed += run<uint8_t>(memory::T_BYTE, 1, "byte", 3);
+  failed += run<int16_t>(memory::T_SHORT, 8, "short, alignment 8", 4);
+  failed += run<double>(memory::T_DOUBLE, 4, "double, alignment 4", 5);
+
+  printf("%zu failed\n", failed);
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,38 @@
+const EventEmitter = require('events');
+
+// Watches addresses from a native polling thread. Only values that changed since the
+// last poll cross over to JavaScript, where they are emitted as events:
+// - 'change' ({ id, address, value }) for every watched address
+// - the id returned by `watch` for that address alone
+// `value` is null while the address cannot be read.
+class Watcher extends EventEmitter {
+  constructor(memoryjs, handle) {
+    super();
+    this.memoryjs = memoryjs;
+    this.native = memoryjs.createWatcher(handle, changes => this.dispatch(changes));
+  }
+
+  watch(address, dataType, interval = 100) {
+    return this.memoryjs.watchAddress(this.native, address, dataType.toLowerCase(), interval);
+  }
+
+  unwatch(id) {
+    return this.memoryjs.unwatchAddress(this.native, id);
+  }
+
+  stop() {
+    this.memoryjs.stopWatcher(this.native);
+  }
+
+  dispatch(changes) {
+    changes.forEach((change) => {
+      // Global event for all watched addresses
+      this.emit('change', change);
+
+      // Event per watched address
+      this.emit(change.id, change);
+    });
+  }
+}
+
+module.exports = Watcher;